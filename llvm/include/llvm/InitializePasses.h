@@ -124,6 +124,7 @@ void initializeAddressSanitizerModulePass(PassRegistry&);
 void initializeMemorySanitizerPass(PassRegistry&);
 void initializeCastVerifierPass(PassRegistry&);
 void initializeCverPruneStackPass(PassRegistry&);
+void initializeCverTypeIdsPass(PassRegistry&);
 void initializeThreadSanitizerPass(PassRegistry&);
 void initializeDataFlowSanitizerPass(PassRegistry&);
 void initializeScalarizerPass(PassRegistry&);
@@ -73,7 +73,37 @@ FunctionPass *createMemorySanitizerPass(int TrackOrigins = 0);
 
 FunctionPass *createCastVerifierPass();
 
-Pass *createCverPruneStackPass();
+// Prune CastVerifier stack hooks. WholeProgram resolves indirect calls to the
+// functions of the module which are address-taken or externally visible, so
+// it assumes that the functions of other modules are reached only through
+// the functions declared here, as under LTO of a program. The hooks left
+// which are tagged with !cver.stack.inline metadata are then lowered inline.
+Pass *createCverPruneStackPass(bool WholeProgram = false);
+
+// Assign dense type IDs and a cast bitmap to CastVerifier THTables (LTO only)
+ModulePass *createCverTypeIdsPass();
+
+// The fields of a CastVerifier THTable, as emitted by clang's
+// CodeGenTHTables::GenerateTypeHierarchy() and rewritten by CverTypeIds pass.
+namespace CverTHTable {
+enum Field {
+  NumContainments,
+  ContainVector,
+  NumBases,
+  HashVector,
+  BaseOffsets,
+  BaseSetMask,
+  BaseSetSlots,
+  NumFlatSegments,
+  FlatContainVector,
+  NumFlatHashes,
+  FlatHashes,
+  TypeId,
+  CastBitmap,
+  TypeName,
+  NumFields
+};
+}
 
 // Insert ThreadSanitizer (race detection) instrumentation
 FunctionPass *createThreadSanitizerPass();
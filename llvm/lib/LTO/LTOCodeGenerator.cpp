@@ -50,6 +50,7 @@
 #include "llvm/Target/TargetRegisterInfo.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Instrumentation.h"
 #include "llvm/Transforms/ObjCARC.h"
 #include <system_error>
 using namespace llvm;
@@ -469,6 +470,15 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
 
   TargetMach->addAnalysisPasses(passes);
 
+  // The whole class hierarchy is visible only here, so assign CastVerifier
+  // type IDs before THTables are optimized. It does nothing without THTables.
+  passes.add(createCverTypeIdsPass());
+  // The targets of indirect calls are visible as well, so prune the stack
+  // hooks that the per-TU pruning had to keep around indirect calls. The
+  // module is internalized by now, and the functions still visible outside
+  // it (e.g., exported from a shared library) remain indirect-call targets.
+  passes.add(createCverPruneStackPass(/*WholeProgram=*/true));
+
   // Enabling internalize here would use its AllButMain variant. It
   // keeps only main if it exists and does nothing for libraries. Instead
   // we create the pass ourselves with the symbol list provided by the linker.
@@ -1,20 +1,27 @@
 #include "llvm/Transforms/Instrumentation.h"
 #include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include "llvm/IR/CFG.h"
+#include "llvm/IR/CallSite.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
 
 #include <algorithm>
 using namespace llvm;
@@ -23,6 +30,9 @@ using namespace llvm;
 
 STATISTIC(NumPrunned, "Pruned Functions");
 STATISTIC(NumNonPrunned, "Non-prunned Functions");
+STATISTIC(NumPrunnedObjects, "Pruned stack objects not escaping");
+STATISTIC(NumIndirectCalls, "Indirect calls resolved by arity");
+STATISTIC(NumLoweredHooks, "Stack hooks lowered inline");
 
 #define CVER_DEBUG(stmt)                        \
   do {                                          \
@@ -37,6 +47,11 @@ static cl::opt<bool> ClDisable(
   cl::desc("Disable CVER stack prunning"),
   cl::Hidden,cl::init(false));
 
+static cl::opt<bool> ClWholeProgram(
+  "cver-stack-prune-whole-program",
+  cl::desc("Resolve indirect calls within the module, as under LTO"),
+  cl::Hidden, cl::init(false));
+
 static cl::opt<bool> ClDebug(
   "cver-stack-prune-debug",
   cl::desc("Debug CVER stack prunning"),
@@ -45,23 +60,69 @@ static cl::opt<bool> ClDebug(
 namespace {
   struct CverPruneStack : public CallGraphSCCPass {
     static char ID; // Pass identification, replacement for typeid
-    CverPruneStack() : CallGraphSCCPass(ID) {
+    CverPruneStack(bool WholeProgram = false)
+      : CallGraphSCCPass(ID), WholeProgram(WholeProgram || ClWholeProgram) {
       initializeCverPruneStackPass(*PassRegistry::getPassRegistry());
     }
 
+    // Whether every function which may be called from this module, other
+    // than the declared ones, is defined in it (i.e., under LTO).
+    bool WholeProgram;
+
     const char *sStackEnter = "__cver_handle_stack_enter";
     const char *sStackExit = "__cver_handle_stack_exit";    
     const char *sCast = "__cver_handle_cast";
-    
+    const char *sCastCacheMiss = "__cver_handle_cast_cache_miss";
+    // The stack hooks to be lowered inline (see LowerInlineStackHooks()), and
+    // the calls on the slow paths of the lowered ones.
+    const char *sInlineKind = "cver.stack.inline";
+    const char *sLoweredKind = "cver.stack.lowered";
+
+    bool IsCastHook(Function *F) {
+      return F->getName() == sCast || F->getName() == sCastCacheMiss;
+    }
+
+    // Whether the body of F which is called may be defined elsewhere, and
+    // may cast (or call back into the module) for all we know. The runtime
+    // hooks other than the cast hooks never cast.
+    bool IsOpaqueFunction(Function *F) {
+      return (F->isDeclaration() || F->mayBeOverridden()) &&
+        !F->isIntrinsic() && !F->getName().startswith("__cver_");
+    }
+
+    // Whether an indirect call may reach F under LTO. Besides the
+    // address-taken functions, a function visible outside the module may have
+    // its address taken in another module (e.g., as a virtual overrider in a
+    // vtable emitted there), and be called back through it.
+    bool MayBeCalledIndirectly(Function *F) {
+      if (F->hasAddressTaken())
+        return true;
+      return !F->hasLocalLinkage() && !F->isIntrinsic() &&
+        !F->getName().startswith("__cver_");
+    }
+
+    // Whether each function may reach __cver_handle_cast, either directly or
+    // through indirect calls. Every function is summarized once per module.
+    DenseMap<Function *, bool> MayCastSummary;
+
     bool PruneWithSCCCallGraph(CallGraphSCC &SCC);
     bool PruneWithDepthFirstSearch(CallGraphSCC &SCC);
+    bool doInitialization(CallGraph &CG) override;
     bool runOnSCC(CallGraphSCC &SCC) override;
     bool IsInvokeStack(Function *F, CallGraph &CG);
-    bool IsAnyCallesInvokeCast(Function *F, CallGraph &CG,
-                               SmallSet<Function *, 32> &Visited, int depth);
+    void SummarizeModule(Module &M);
 
     bool CollectStackInvokeInstructions(
       Function *F, SmallVector<Instruction *, 16> &StackInvokes);
+    bool CollectNonEscapingStackInvokeInstructions(
+      Function *F, SmallVector<Instruction *, 16> &StackInvokes);
+    bool MayEscape(AllocaInst *AI);
+    bool MayCallCast(Function *F);
+    bool IsLoweredStackHook(CallInst *CI);
+
+    bool LowerInlineStackHooks(Function *F);
+    bool LowerStackEnter(CallInst *CI, AllocaInst *SavedTop);
+    bool LowerStackExit(CallInst *CI, AllocaInst *SavedTop);
   };
 }
 
@@ -72,8 +133,8 @@ INITIALIZE_PASS_DEPENDENCY(CallGraphWrapperPass)
 INITIALIZE_PASS_END(CverPruneStack, "cver-prune-stack",
                 "Prunning stack traces for CastVerifier", false, false)
 
-Pass *llvm::createCverPruneStackPass() {
-  return new CverPruneStack();
+Pass *llvm::createCverPruneStackPass(bool WholeProgram) {
+  return new CverPruneStack(WholeProgram);
 }
 
 bool CverPruneStack::IsInvokeStack(Function *F, CallGraph &CG) {
@@ -87,38 +148,212 @@ bool CverPruneStack::IsInvokeStack(Function *F, CallGraph &CG) {
   return false;
 }
 
-bool CverPruneStack::IsAnyCallesInvokeCast(
-  Function *F, CallGraph &CG, SmallSet<Function *, 32> &Visited, int depth) {
+// Under LTO, indirect calls are resolved to the functions of the same arity
+// which may be called indirectly (see MayBeCalledIndirectly()), including
+// every virtual function defined here. The exact function type is too
+// strict, as an overrider takes its own class as 'this', and may return a
+// covariant type.
+static unsigned getIndirectCallKey(FunctionType *FTy) {
+  return (FTy->getNumParams() << 1) | FTy->isVarArg();
+}
 
+// Summarize the whole module at once, by propagating the may-cast property
+// from the cast hooks and the declared functions to the callers.
+//
+// Within a TU, an indirect call may reach a function defined in another TU
+// (e.g., a virtual function overridden there), so its caller may cast.
+// Under LTO, an indirect call site reaches every function of its key which
+// may be called indirectly, declared ones included, so the callers through an
+// indirect call are propagated once the first function of the key may cast.
+void CverPruneStack::SummarizeModule(Module &M) {
+  DenseMap<Function *, SmallVector<Function *, 4> > Callers;
+  DenseMap<unsigned, SmallVector<Function *, 4> > IndirectCallers;
+  SmallPtrSet<Function *, 64> MayCast;
+  SmallVector<Function *, 64> Worklist;
+
+  for (Module::iterator F = M.begin(), FE = M.end(); F != FE; ++F) {
+    MayCastSummary[F] = false;
+    if (IsCastHook(F) || IsOpaqueFunction(F)) {
+      MayCast.insert(F);
+      Worklist.push_back(F);
+    }
 
-  CVER_DEBUG("\t Analyzing " << F->getName() << "\n");
-  // static int maxDepth = 500;
-  // if (depth >= maxDepth) {
-  //   return true;
-  // }
+    for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+      CallSite CS(&*I);
+      if (!CS)
+        continue;
+      Value *V = CS.getCalledValue();
+      if (isa<InlineAsm>(V))
+        continue;
+      if (Function *Callee = dyn_cast<Function>(V->stripPointerCasts())) {
+        Callers[Callee].push_back(F);
+        continue;
+      }
 
-  assert(!Visited.count(F));
-  Visited.insert(F);
-  
-  CallGraphNode *CGNode = CG[F];
+      if (!WholeProgram) {
+        if (MayCast.insert(F))
+          Worklist.push_back(F);
+        continue;
+      }
+      FunctionType *FTy = cast<FunctionType>(
+        cast<PointerType>(V->getType())->getElementType());
+      IndirectCallers[getIndirectCallKey(FTy)].push_back(F);
+      NumIndirectCalls++;
+    }
+  }
 
-  bool mayCast = false;
-  for (CallGraphNode::iterator I = CGNode->begin(); I != CGNode->end(); ++I) {
-    Function *calleeFunction = I->second->getFunction();
-    if (!calleeFunction)
-      continue;
-    
-    if (calleeFunction->getName() == sCast)
-      return true;
+  SmallSet<unsigned, 8> VisitedKeys;
+  while (!Worklist.empty()) {
+    Function *F = Worklist.pop_back_val();
+    SmallVector<Function *, 16> FCallers;
+    DenseMap<Function *, SmallVector<Function *, 4> >::iterator it =
+      Callers.find(F);
+    if (it != Callers.end())
+      FCallers.append(it->second.begin(), it->second.end());
+    if (MayBeCalledIndirectly(F)) {
+      unsigned Key = getIndirectCallKey(F->getFunctionType());
+      if (VisitedKeys.insert(Key)) {
+        SmallVector<Function *, 4> &IC = IndirectCallers[Key];
+        FCallers.append(IC.begin(), IC.end());
+      }
+    }
 
-    if (!Visited.count(calleeFunction))
-      mayCast |= IsAnyCallesInvokeCast(calleeFunction, CG, Visited, depth+1);
+    for (Function *Caller : FCallers)
+      if (MayCast.insert(Caller))
+        Worklist.push_back(Caller);
+  }
 
-    // If the callee may cast, then simply return true.
-    if (mayCast)
-      return true;
+  for (Function *F : MayCast) {
+    CVER_DEBUG("\t Summary " << F->getName() << " : 1\n");
+    MayCastSummary[F] = true;
   }
-  return mayCast;
+}
+
+bool CverPruneStack::MayCallCast(Function *F) {
+  DenseMap<Function *, bool>::iterator it = MayCastSummary.find(F);
+  // Not summarized, as it is created after the module is summarized.
+  if (it == MayCastSummary.end())
+    return true;
+  return it->second;
+}
+
+// Returns the stack object which the stack hook CI is invoked on.
+static AllocaInst *getTrackedAlloca(CallInst *CI) {
+  if (CI->getNumArgOperands() < 2)
+    return nullptr;
+  Value *V = CI->getArgOperand(1);
+  if (PtrToIntInst *PI = dyn_cast<PtrToIntInst>(V))
+    V = PI->getOperand(0);
+  else if (ConstantExpr *CE = dyn_cast<ConstantExpr>(V))
+    if (CE->getOpcode() == Instruction::PtrToInt)
+      V = CE->getOperand(0);
+  return dyn_cast<AllocaInst>(V->stripPointerCasts());
+}
+
+// Check if the address of the stack object may reach __cver_handle_cast,
+// either in this function or anywhere else. The address may escape if it is
+// stored into memory, returned, or passed to a function which may capture it
+// or may cast.
+bool CverPruneStack::MayEscape(AllocaInst *AI) {
+  SmallVector<Value *, 16> Worklist;
+  SmallPtrSet<Value *, 16> Visited;
+  Worklist.push_back(AI);
+  Visited.insert(AI);
+
+  while (!Worklist.empty()) {
+    Value *V = Worklist.pop_back_val();
+    for (User *U : V->users()) {
+      Instruction *I = dyn_cast<Instruction>(U);
+      if (!I)
+        return true;
+
+      switch (I->getOpcode()) {
+      case Instruction::Load:
+      case Instruction::ICmp:
+        continue;
+      case Instruction::Store:
+        // Storing into the object is fine, but storing the address is not.
+        if (cast<StoreInst>(I)->getValueOperand() == V)
+          return true;
+        continue;
+      case Instruction::BitCast:
+      case Instruction::GetElementPtr:
+      case Instruction::PtrToInt:
+      case Instruction::PHI:
+      case Instruction::Select:
+        if (Visited.insert(I))
+          Worklist.push_back(I);
+        continue;
+      case Instruction::Call:
+      case Instruction::Invoke: {
+        CallSite CS(I);
+        Function *Callee = CS.getCalledFunction();
+        if (!Callee)
+          return true;
+        if (Callee->getName() == sStackEnter ||
+            Callee->getName() == sStackExit)
+          continue;
+        if (isa<DbgInfoIntrinsic>(I) || isa<MemIntrinsic>(I))
+          continue;
+        if (IntrinsicInst *II = dyn_cast<IntrinsicInst>(I))
+          if (II->getIntrinsicID() == Intrinsic::lifetime_start ||
+              II->getIntrinsicID() == Intrinsic::lifetime_end)
+            continue;
+
+        // The callee may cast the address while the object is alive.
+        if (Callee->isDeclaration() || MayCallCast(Callee))
+          return true;
+        for (unsigned i = 0, e = CS.arg_size(); i != e; ++i)
+          if (CS.getArgument(i) == V && !CS.doesNotCapture(i))
+            return true;
+        continue;
+      }
+      default:
+        // Returned, or used in an unknown way.
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Collect the stack hooks on the stack objects not escaping, even though F
+// may cast other pointers.
+bool CverPruneStack::CollectNonEscapingStackInvokeInstructions(
+  Function *F, SmallVector<Instruction *, 16> &StackInvokes) {
+
+  SmallVector<std::pair<CallInst *, AllocaInst *>, 16> Hooks;
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB)
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I)
+      if (CallInst *CI = dyn_cast<CallInst>(I)) {
+        Function *Callee = CI->getCalledFunction();
+        if (!Callee)
+          continue;
+        if ((Callee->getName() == sStackEnter ||
+             Callee->getName() == sStackExit) && !IsLoweredStackHook(CI))
+          Hooks.push_back(std::make_pair(CI, getTrackedAlloca(CI)));
+      }
+
+  SmallPtrSet<AllocaInst *, 16> Escaping;
+  SmallPtrSet<AllocaInst *, 16> NonEscaping;
+  bool isCollected = false;
+  for (auto &Hook : Hooks) {
+    AllocaInst *AI = Hook.second;
+    if (!AI || Escaping.count(AI))
+      continue;
+    if (!NonEscaping.count(AI)) {
+      if (MayEscape(AI)) {
+        Escaping.insert(AI);
+        continue;
+      }
+      CVER_DEBUG("\t Not escaping : " << *AI << "\n");
+      NonEscaping.insert(AI);
+      NumPrunnedObjects++;
+    }
+    StackInvokes.push_back(Hook.first);
+    isCollected = true;
+  }
+  return isCollected;
 }
 
 bool CverPruneStack::PruneWithDepthFirstSearch(CallGraphSCC &SCC) {
@@ -147,8 +382,7 @@ bool CverPruneStack::PruneWithDepthFirstSearch(CallGraphSCC &SCC) {
       continue;
     }
     
-    SmallSet<Function *, 32> Visited;
-    bool mayCast = IsAnyCallesInvokeCast(F, CG, Visited, 0);
+    bool mayCast = MayCallCast(F);
     CVER_DEBUG("\t mayCast : " << mayCast << "\n");
     
     if (!mayCast) {
@@ -158,6 +392,8 @@ bool CverPruneStack::PruneWithDepthFirstSearch(CallGraphSCC &SCC) {
       NumPrunned++;        
       isModified = true;
     } else {
+      // F may cast, but not necessarily on its own stack objects.
+      isModified |= CollectNonEscapingStackInvokeInstructions(F, InstToDelete);
       NumNonPrunned++;
     }
 
@@ -183,8 +419,8 @@ bool CverPruneStack::CollectStackInvokeInstructions(
         if (!Callee)
           continue;
           
-        if (Callee->getName() == sStackEnter ||
-            Callee->getName() == sStackExit) {
+        if ((Callee->getName() == sStackEnter ||
+             Callee->getName() == sStackExit) && !IsLoweredStackHook(CI)) {
 
           CVER_DEBUG("[*] Prunning " << Callee->getName() << " in " <<
                      F->getName() << "\n");
@@ -213,11 +449,13 @@ bool CverPruneStack::PruneWithSCCCallGraph(CallGraphSCC &SCC) {
         if (CallInst *CI = dyn_cast<CallInst>(I)) {
           Function *Callee = CI->getCalledFunction();
           if (!Callee) {
+            if (!MayCallCast(F))
+              continue;
             CVER_DEBUG("\t mayCallCast due to indirect calls\n");
-            // Indirect call, and we lost the control.
+            // The summary of F covers the targets of its indirect calls.
             mayCallCast = true;
             break;
-          } else if (Callee->getName() == sCast) {
+          } else if (IsCastHook(Callee)) {
             CVER_DEBUG("\t mayCallCast due to explicit __cver_handle_cast\n");
             mayCallCast = true;
             break;
@@ -249,20 +487,205 @@ bool CverPruneStack::PruneWithSCCCallGraph(CallGraphSCC &SCC) {
   return isModified;
 }
 
+bool CverPruneStack::doInitialization(CallGraph &CG) {
+  MayCastSummary.clear();
+  // Nothing to prune without the stack hooks (e.g., under LTO of modules
+  // built without -fsanitize=cver-stack).
+  if (!CG.getModule().getFunction(sStackEnter))
+    return false;
+  SummarizeModule(CG.getModule());
+  return false;
+}
+
 // If any of function in SCC must not call __stack_handle_cast,
 // then we do prune out all __cver_handle_stack_enter in the SCC.
 bool CverPruneStack::runOnSCC(CallGraphSCC &SCC) {
-  if (ClDisable)
-    return false;
-  
-  bool isModified;
+  bool isModified = false;
 
   // Looks like SCCCallGraph is not a good choice (too many functions out of SCC
   // set), and hand-written DFS style call-graph scanning is working quite nice.
-  // So SCC analysis is commented out.
-  
+  // So SCC analysis is commented out. The DFS is memoized by the summaries of
+  // the module, so each function is scanned only once.
+
   // isModified = PruneWithSCCCallGraph(SCC);
-  isModified = PruneWithDepthFirstSearch(SCC);
-  
-  return isModified;;
+  if (!ClDisable)
+    isModified = PruneWithDepthFirstSearch(SCC);
+
+  // The hooks which survived are lowered even if pruning is disabled.
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I)
+    if (Function *F = (*I)->getFunction())
+      isModified |= LowerInlineStackHooks(F);
+
+  return isModified;
+}
+
+// Whether CI is on the slow path of a lowered stack hook. It cannot be pruned
+// on its own, as the inline part around it stays.
+bool CverPruneStack::IsLoweredStackHook(CallInst *CI) {
+  return CI->getMetadata(sLoweredKind) != nullptr;
+}
+
+static GlobalVariable *getShadowStackVar(Module &M, StringRef Name,
+                                         Type *Ty) {
+  if (GlobalVariable *GV = M.getNamedGlobal(Name))
+    return GV;
+  return new GlobalVariable(M, Ty, false, GlobalValue::ExternalLinkage,
+                            nullptr, Name, nullptr,
+                            GlobalVariable::InitialExecTLSModel);
+}
+
+// Moves CI into a block of its own, which is branched to from the rest of the
+// block before CI, and branches to the rest after CI.
+static BasicBlock *splitAroundCall(CallInst *CI, const Twine &SlowName,
+                                   const Twine &ContName) {
+  BasicBlock *Head = CI->getParent();
+  Head->splitBasicBlock(std::next(BasicBlock::iterator(CI)), ContName);
+  return Head->splitBasicBlock(CI, SlowName);
+}
+
+// Lowers the stack hooks tagged by clang with -fsanitize-cver-stack-inline,
+// once pruning is done with them: __cver_handle_stack_enter appends an entry
+// to __cver_shadow_stack_top, and __cver_handle_stack_exit pops it by
+// restoring the top saved by the enter. The hooks stay on the slow paths. The
+// layout should be matched with ShadowStackEntry in the runtime.
+bool CverPruneStack::LowerInlineStackHooks(Function *F) {
+  SmallVector<CallInst *, 16> Enters;
+  SmallVector<CallInst *, 16> Exits;
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I)
+    if (CallInst *CI = dyn_cast<CallInst>(&*I)) {
+      if (!CI->getMetadata(sInlineKind))
+        continue;
+      Function *Callee = CI->getCalledFunction();
+      if (Callee && Callee->getName() == sStackEnter)
+        Enters.push_back(CI);
+      else if (Callee && Callee->getName() == sStackExit)
+        Exits.push_back(CI);
+    }
+  if (Enters.empty() && Exits.empty())
+    return false;
+
+  // The top saved for each stack object. It is null until the object is
+  // registered, in case an exit is reached without the enter, e.g. by a goto
+  // past the declaration.
+  DenseMap<AllocaInst *, AllocaInst *> SavedTops;
+  for (CallInst *CI : Enters) {
+    AllocaInst *AI = getTrackedAlloca(CI);
+    if (!AI)
+      continue;
+    AllocaInst *&SavedTop = SavedTops[AI];
+    if (!SavedTop) {
+      IRBuilder<> IRB(F->getEntryBlock().getFirstInsertionPt());
+      Type *EntryPtrTy = CI->getArgOperand(1)->getType()->getPointerTo();
+      SavedTop = IRB.CreateAlloca(EntryPtrTy, nullptr, "cver.saved.top");
+      IRB.CreateStore(Constant::getNullValue(EntryPtrTy), SavedTop);
+    }
+    if (LowerStackEnter(CI, SavedTop))
+      NumLoweredHooks++;
+  }
+
+  for (CallInst *CI : Exits) {
+    AllocaInst *AI = getTrackedAlloca(CI);
+    DenseMap<AllocaInst *, AllocaInst *>::iterator it = SavedTops.find(AI);
+    if (AI && it != SavedTops.end() && LowerStackExit(CI, it->second))
+      NumLoweredHooks++;
+  }
+
+  for (CallInst *CI : Enters)
+    CI->setMetadata(sInlineKind, nullptr);
+  for (CallInst *CI : Exits)
+    CI->setMetadata(sInlineKind, nullptr);
+  return true;
+}
+
+// Appends the entry if the top is below __cver_shadow_stack_end, or calls the
+// hook otherwise (the shadow stack is full, or not set up for this thread
+// yet).
+bool CverPruneStack::LowerStackEnter(CallInst *CI, AllocaInst *SavedTop) {
+  // The arguments are the static data holding the THTable, the address, the
+  // number of elements and the size of the object.
+  GlobalVariable *Data =
+    dyn_cast<GlobalVariable>(CI->getArgOperand(0)->stripPointerCasts());
+  if (!CI->use_empty() || CI->getNumArgOperands() != 4 || !Data ||
+      !Data->hasInitializer())
+    return false;
+  Constant *TypeTable = Data->getInitializer()->getAggregateElement(0u);
+  if (!TypeTable)
+    return false;
+
+  Module &M = *CI->getParent()->getParent()->getParent();
+  Value *Addr = CI->getArgOperand(1);
+  Type *IntptrTy = Addr->getType();
+  Type *EntryPtrTy = IntptrTy->getPointerTo();
+  GlobalVariable *TopVar =
+    getShadowStackVar(M, "__cver_shadow_stack_top", EntryPtrTy);
+  GlobalVariable *EndVar =
+    getShadowStackVar(M, "__cver_shadow_stack_end", EntryPtrTy);
+
+  IRBuilder<> IRB(CI);
+  Value *Top = IRB.CreateLoad(TopVar);
+  Value *End = IRB.CreateLoad(EndVar);
+  IRB.CreateStore(Top, SavedTop);
+  Value *HasRoom = IRB.CreateICmpULT(Top, End);
+
+  BasicBlock *Head = CI->getParent();
+  BasicBlock *SlowBB =
+    splitAroundCall(CI, "cver.stack.slow", "cver.stack.cont");
+  BasicBlock *ContBB = SlowBB->getTerminator()->getSuccessor(0);
+  BasicBlock *InlineBB = BasicBlock::Create(M.getContext(), "cver.stack.inline",
+                                            Head->getParent(), SlowBB);
+  ReplaceInstWithInst(Head->getTerminator(),
+                      BranchInst::Create(InlineBB, SlowBB, HasRoom));
+
+  IRB.SetInsertPoint(InlineBB);
+  IRB.CreateStore(Addr, Top);
+  IRB.CreateStore(CI->getArgOperand(3), IRB.CreateConstGEP1_32(Top, 1));
+  IRB.CreateStore(ConstantExpr::getPtrToInt(TypeTable, IntptrTy),
+                  IRB.CreateConstGEP1_32(Top, 2));
+  IRB.CreateStore(IRB.CreateConstGEP1_32(Top, 3), TopVar);
+  IRB.CreateBr(ContBB);
+
+  CI->setMetadata(sLoweredKind, MDNode::get(M.getContext(), None));
+  return true;
+}
+
+// Pops the entry by restoring the saved top if the entry is still the last
+// one, or calls the hook otherwise (the runtime has sorted the entry in, or
+// registered it on the slow path).
+bool CverPruneStack::LowerStackExit(CallInst *CI, AllocaInst *SavedTop) {
+  if (!CI->use_empty() || CI->getNumArgOperands() != 2)
+    return false;
+
+  Module &M = *CI->getParent()->getParent()->getParent();
+  Value *Addr = CI->getArgOperand(1);
+  Type *EntryPtrTy = Addr->getType()->getPointerTo();
+  GlobalVariable *TopVar =
+    getShadowStackVar(M, "__cver_shadow_stack_top", EntryPtrTy);
+
+  IRBuilder<> IRB(CI);
+  Value *Saved = IRB.CreateLoad(SavedTop);
+  Value *Top = IRB.CreateLoad(TopVar);
+  // Saved is only dereferenced if the top is right past its entry.
+  Value *IsLast = IRB.CreateICmpEQ(Top, IRB.CreateConstGEP1_32(Saved, 3));
+
+  BasicBlock *Head = CI->getParent();
+  BasicBlock *SlowBB =
+    splitAroundCall(CI, "cver.stack.exit.slow", "cver.stack.exit.cont");
+  BasicBlock *ContBB = SlowBB->getTerminator()->getSuccessor(0);
+  BasicBlock *CheckBB = BasicBlock::Create(
+    M.getContext(), "cver.stack.exit.check", Head->getParent(), SlowBB);
+  BasicBlock *InlineBB = BasicBlock::Create(
+    M.getContext(), "cver.stack.exit.inline", Head->getParent(), SlowBB);
+  ReplaceInstWithInst(Head->getTerminator(),
+                      BranchInst::Create(CheckBB, SlowBB, IsLast));
+
+  IRB.SetInsertPoint(CheckBB);
+  IRB.CreateCondBr(IRB.CreateICmpEQ(IRB.CreateLoad(Saved), Addr),
+                   InlineBB, SlowBB);
+
+  IRB.SetInsertPoint(InlineBB);
+  IRB.CreateStore(Saved, TopVar);
+  IRB.CreateBr(ContBB);
+
+  CI->setMetadata(sLoweredKind, MDNode::get(M.getContext(), None));
+  return true;
 }
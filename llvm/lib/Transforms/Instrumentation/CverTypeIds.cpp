@@ -0,0 +1,168 @@
+// CverTypeIds pass is invoked on the merged module during LTO, where every
+// THTable of the program is visible. It assigns each type a dense integer ID
+// and emits a (source type x target type) bitmap of the base memberships, so
+// that the runtime can answer most of the cast validity with a single bit test.
+//
+// THTables are collected through the "cver.thtables" named metadata, whose
+// nodes are { THTable, i1 IsExternal }. The fields are CverTHTable::Field.
+
+#include "llvm/Transforms/Instrumentation.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <map>
+#include <vector>
+using namespace llvm;
+
+#define DEBUG_TYPE "cver-type-ids"
+
+STATISTIC(NumTypeIds, "Assigned type IDs");
+STATISTIC(NumTHTables, "Updated THTables");
+
+#define CVER_DEBUG(stmt)                        \
+  do {                                          \
+    if (ClDebug) {                              \
+      llvm::errs() << stmt;                     \
+    }                                           \
+  } while(0)
+
+static cl::opt<bool> ClDebug(
+  "cver-type-ids-debug",
+  cl::desc("Debug CVER type IDs"),
+  cl::Hidden, cl::init(false));
+
+// The bitmap grows quadratically, so give up on too large programs.
+static cl::opt<unsigned> ClMaxTypeIds(
+  "cver-max-type-ids",
+  cl::desc("Maximum number of types to build the CVER cast bitmap"),
+  cl::Hidden, cl::init(8192));
+
+namespace {
+  struct CverTypeIds : public ModulePass {
+    static char ID; // Pass identification, replacement for typeid
+    CverTypeIds() : ModulePass(ID) {
+      initializeCverTypeIdsPass(*PassRegistry::getPassRegistry());
+    }
+
+    bool runOnModule(Module &M) override;
+  };
+}
+
+char CverTypeIds::ID = 0;
+INITIALIZE_PASS(CverTypeIds, "cver-type-ids",
+                "Assigning dense type IDs for CastVerifier", false, false)
+
+ModulePass *llvm::createCverTypeIdsPass() {
+  return new CverTypeIds();
+}
+
+static uint64_t getElementValue(Constant *C, unsigned i) {
+  return cast<ConstantInt>(C->getAggregateElement(i))->getZExtValue();
+}
+
+bool CverTypeIds::runOnModule(Module &M) {
+  NamedMDNode *THTableMD = M.getNamedMetadata("cver.thtables");
+  if (!THTableMD)
+    return false;
+
+  // Multiple THTables of the same type (emitted in different translation
+  // units) share the same ID, which is keyed by the hash of the type. The
+  // hashes of the types with internal linkage are not unique across
+  // translation units, so these types get no ID, and their casts are checked
+  // without the bitmap.
+  std::map<uint64_t, unsigned> TypeIds;
+  std::vector<SmallVector<uint64_t, 8> > BaseHashes;
+  SmallVector<GlobalVariable *, 64> THTables;
+
+  for (unsigned i = 0, e = THTableMD->getNumOperands(); i != e; ++i) {
+    MDNode *N = THTableMD->getOperand(i);
+    if (N->getNumOperands() != 2)
+      continue;
+    GlobalVariable *GV = dyn_cast_or_null<GlobalVariable>(N->getOperand(0));
+    ConstantInt *IsExternal = dyn_cast_or_null<ConstantInt>(N->getOperand(1));
+    if (!GV || !GV->hasInitializer() || !IsExternal || IsExternal->isZero())
+      continue;
+
+    ConstantStruct *Init = dyn_cast<ConstantStruct>(GV->getInitializer());
+    if (!Init || Init->getNumOperands() != CverTHTable::NumFields)
+      continue;
+
+    // The hash vector starts from the hash of the owner.
+    Constant *HashVector = Init->getOperand(CverTHTable::HashVector);
+    unsigned NumHashes = HashVector->getType()->getArrayNumElements();
+    if (NumHashes == 0)
+      continue;
+
+    uint64_t OwnHash = getElementValue(HashVector, 0) & ~1ULL;
+    THTables.push_back(GV);
+    if (TypeIds.count(OwnHash))
+      continue;
+
+    TypeIds[OwnHash] = BaseHashes.size() + 1;
+    BaseHashes.push_back(SmallVector<uint64_t, 8>());
+    for (unsigned j = 0; j < NumHashes; j++)
+      BaseHashes.back().push_back(getElementValue(HashVector, j) & ~1ULL);
+  }
+
+  uint64_t NumIds = BaseHashes.size();
+  if (NumIds == 0 || NumIds > ClMaxTypeIds) {
+    CVER_DEBUG("Skip the cast bitmap with " << NumIds << " types\n");
+    return false;
+  }
+  NumTypeIds += NumIds;
+
+  // Bit (Src-1) * NumIds + (Dst-1) is set if a Src object can be cast to Dst,
+  // i.e., Dst is one of Src or its bases. This should be matched with
+  // IsInCastBitmap() in the runtime.
+  std::vector<uint64_t> Bits((NumIds * NumIds + 63) / 64, 0);
+  for (uint64_t Src = 0; Src < NumIds; Src++) {
+    for (uint64_t Hash : BaseHashes[Src]) {
+      auto it = TypeIds.find(Hash);
+      if (it == TypeIds.end())
+        continue;
+      uint64_t Bit = Src * NumIds + (it->second - 1);
+      Bits[Bit / 64] |= 1ULL << (Bit % 64);
+    }
+  }
+
+  LLVMContext &C = M.getContext();
+  Type *Int64Ty = Type::getInt64Ty(C);
+  Constant *BitmapFields[] = {
+    ConstantInt::get(Int64Ty, NumIds),
+    ConstantDataArray::get(C, Bits)
+  };
+  Constant *Bitmap = ConstantStruct::getAnon(BitmapFields);
+  auto *BitmapGV = new GlobalVariable(M, Bitmap->getType(), /*isConstant=*/true,
+                                      GlobalVariable::PrivateLinkage, Bitmap,
+                                      "cver.cast_bitmap");
+  Constant *BitmapAddr = ConstantExpr::getPtrToInt(BitmapGV, Int64Ty);
+
+  // Record the IDs and the bitmap in THTables.
+  for (GlobalVariable *GV : THTables) {
+    ConstantStruct *Init = cast<ConstantStruct>(GV->getInitializer());
+    uint64_t OwnHash =
+      getElementValue(Init->getOperand(CverTHTable::HashVector), 0) & ~1ULL;
+
+    SmallVector<Constant *, CverTHTable::NumFields> Fields;
+    for (unsigned i = 0; i < CverTHTable::NumFields; i++)
+      Fields.push_back(Init->getOperand(i));
+    Fields[CverTHTable::TypeId] = ConstantInt::get(Int64Ty, TypeIds[OwnHash]);
+    Fields[CverTHTable::CastBitmap] = BitmapAddr;
+
+    GV->setInitializer(ConstantStruct::get(Init->getType(), Fields));
+    NumTHTables++;
+  }
+
+  CVER_DEBUG("Assigned " << NumIds << " type IDs to " << THTables.size()
+             << " THTables\n");
+  return true;
+}
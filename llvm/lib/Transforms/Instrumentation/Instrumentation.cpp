@@ -28,6 +28,8 @@ void llvm::initializeInstrumentation(PassRegistry &Registry) {
   initializeMemorySanitizerPass(Registry);
   initializeThreadSanitizerPass(Registry);
   initializeDataFlowSanitizerPass(Registry);
+  initializeCverPruneStackPass(Registry);
+  initializeCverTypeIdsPass(Registry);
 }
 
 /// LLVMInitializeInstrumentation - C binding for
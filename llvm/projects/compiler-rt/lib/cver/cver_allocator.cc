@@ -4,9 +4,12 @@
 
 #include "cver_internal.h"
 #include "cver_allocator.h"
+#include "cver_allocator_cache.h"
+#include "cver_common.h"
 #include "cver_thread.h"
 #include "cver_init.h"
 #include "cver_flags.h"
+#include "cver_shadow_metadata.h"
 
 #ifndef CVER_USE_INTERNAL_ALLOCATOR
 #include <malloc.h>
@@ -43,7 +46,7 @@ static const uptr kMaxAllowedMallocSize = 8UL << 30;
 typedef SizeClassAllocator64<kAllocatorSpace, kAllocatorSize, kMetadataSize,
                              DefaultSizeClassMap,
                              CverMapUnmapCallback> PrimaryAllocator;
-typedef SizeClassAllocatorLocalCache<PrimaryAllocator> AllocatorCache;
+typedef CverLocalCache<PrimaryAllocator> AllocatorCache;
 typedef LargeMmapAllocator<CverMapUnmapCallback> SecondaryAllocator;
 typedef CombinedAllocator<PrimaryAllocator, AllocatorCache,
                           SecondaryAllocator> Allocator;
@@ -51,23 +54,115 @@ typedef CombinedAllocator<PrimaryAllocator, AllocatorCache,
 static Allocator allocator;
 static AllocatorCache fallback_allocator_cache;
 static SpinMutex fallback_mutex;
+static StaticSpinMutex release_mutex;
+
+// The secondary allocator locates its chunks under its global mutex. Instead,
+// every page of a secondary chunk maps to the beginning of the chunk in a
+// two-level page table, so that casts locate the chunks without a lock. The
+// second-level tables are mapped on demand, and never unmapped.
+static const uptr kSecondaryPageShift = 12;
+static const uptr kSecondaryRegionShift = 30;
+static const uptr kSecondaryNumRegions = 1ULL << (47 - kSecondaryRegionShift);
+static const uptr kSecondaryPagesPerRegion =
+  1ULL << (kSecondaryRegionShift - kSecondaryPageShift);
+static atomic_uintptr_t secondary_regions[kSecondaryNumRegions];
+
+static atomic_uintptr_t *GetSecondaryPageEntry(uptr p, bool create) {
+  uptr region = p >> kSecondaryRegionShift;
+  if (UNLIKELY(region >= kSecondaryNumRegions))
+    return 0;
+  uptr table = atomic_load(&secondary_regions[region], memory_order_acquire);
+  if (UNLIKELY(!table)) {
+    if (!create)
+      return 0;
+    uptr size = kSecondaryPagesPerRegion * sizeof(atomic_uintptr_t);
+    uptr new_table = (uptr)MmapOrDie(size, "CverSecondaryPageTable");
+    if (atomic_compare_exchange_strong(&secondary_regions[region], &table,
+                                       new_table, memory_order_acq_rel)) {
+      table = new_table;
+    } else {
+      UnmapOrDie((void *)new_table, size);
+    }
+  }
+  uptr idx = (p >> kSecondaryPageShift) & (kSecondaryPagesPerRegion - 1);
+  return &((atomic_uintptr_t *)table)[idx];
+}
+
+static void SetSecondaryPages(uptr beg, uptr size, uptr value) {
+  uptr end = beg + RoundUpTo(size, 1ULL << kSecondaryPageShift);
+  for (uptr p = beg; p < end; p += 1ULL << kSecondaryPageShift)
+    if (atomic_uintptr_t *e = GetSecondaryPageEntry(p, value != 0))
+      atomic_store(e, value, memory_order_release);
+}
+
+// Returns the beginning of the secondary chunk containing p, or 0.
+static CVER_INLINE uptr GetSecondaryBlockBegin(uptr p) {
+  atomic_uintptr_t *e = GetSecondaryPageEntry(p, false);
+  if (!e)
+    return 0;
+  return atomic_load(e, memory_order_acquire);
+}
 
 AllocatorCache *GetAllocatorCache(CverThreadLocalMallocStorage *cs) {
   CHECK(cs);
-  CHECK_LE(sizeof(AllocatorCache), sizeof(cs->allocator_cache));
+  if (UNLIKELY(!cs->allocator_cache)) {
+    void *cache = InternalAlloc(sizeof(AllocatorCache));
+    CHECK(cache);
+    internal_memset(cache, 0, sizeof(AllocatorCache));
+    cs->allocator_cache = cache;
+    CVER_DEBUG_STMT(flags()->stats, {
+        CverStats &thread_stats = GetCurrentThreadStats();
+        thread_stats.allocatorCacheBytes += sizeof(AllocatorCache);
+        thread_stats.allocatorCachePeak =
+          Max(thread_stats.allocatorCachePeak, sizeof(AllocatorCache));
+      });
+  }
   return reinterpret_cast<AllocatorCache *>(cs->allocator_cache);
 }
 
 void CverThreadLocalMallocStorage::CommitBack() {
-  allocator.SwallowCache(GetAllocatorCache(this));
+  if (ShadowMetadataEnabled() || !allocator_cache)
+    return;
+  AllocatorCache *cache = GetAllocatorCache(this);
+  VReport(1, "T%d: allocator cache of %zuK at most\n",
+          (int)GetCurrentTidOrInvalid(), cache->PeakFootprint() >> 10);
+  allocator.SwallowCache(cache);
+  InternalFree(allocator_cache);
+  allocator_cache = 0;
+  CVER_DEBUG_STMT(flags()->stats, {
+      GetCurrentThreadStats().allocatorCacheBytes -= sizeof(AllocatorCache);
+    });
 }
 
 void InitializeAllocator() {
+  if (ShadowMetadataEnabled()) {
+    InitializeShadowMetadata();
+    return;
+  }
   allocator.Init();
 }
 
+// Types the chunk of size bytes. The element size of an array is computed
+// here once, instead of on every cast on its elements. If the type does not
+// fit in, the chunk is left untyped, even if it was typed before.
+static void SetMetaDataType(Metadata *meta, uptr size, uptr type_table,
+                            uptr num_elements) {
+  uptr element_size = 0;
+  if (num_elements > 0) {
+    // The size includes an array cookie, so the elements cannot be located.
+    if (UNLIKELY(size % num_elements)) {
+      meta->SetUntyped(size);
+      return;
+    }
+    element_size = size / num_elements;
+  }
+  if (UNLIKELY(!meta->SetTyped(type_table, element_size)))
+    meta->SetUntyped(size);
+}
+
 static void *CverAllocate(StackTrace *stack, uptr size, uptr alignment,
-                          bool zeroise) {
+                          bool zeroise, uptr type_table = 0,
+                          uptr num_elements = 0) {
   if (size > kMaxAllowedMallocSize) {
     Report("WARNING: MemorySanitizer failed to allocate %p bytes\n",
            (void *)size);
@@ -83,11 +178,13 @@ static void *CverAllocate(StackTrace *stack, uptr size, uptr alignment,
     AllocatorCache *cache = &fallback_allocator_cache;
     allocated = allocator.Allocate(cache, size, alignment, false);
   }
+  if (!allocator.FromPrimary(allocated))
+    SetSecondaryPages((uptr)allocated, size, (uptr)allocated);
   Metadata *meta =
       reinterpret_cast<Metadata *>(allocator.GetMetaData(allocated));
-  meta->requested_size = size;
-  meta->type_table = 0;
-  meta->num_elements = 0;
+  meta->SetUntyped(size);
+  if (type_table)
+    SetMetaDataType(meta, size, type_table, num_elements);
 
   if (zeroise)
     internal_memset(allocated, 0, size);
@@ -95,19 +192,49 @@ static void *CverAllocate(StackTrace *stack, uptr size, uptr alignment,
   return allocated;
 }
 
+// Returns the free pages of the primary allocator to the OS. Only one thread
+// does this at a time; the others keep going instead of waiting for it.
+static void ReleaseFreeMemoryToOS(CverThread *t) {
+  if (!release_mutex.TryLock())
+    return;
+  // Our own cached chunks would never be released otherwise.
+  t->malloc_storage().CommitBack();
+  uptr released = 0;
+  for (uptr class_id = 1; class_id < PrimaryAllocator::kNumClasses; class_id++)
+    released += allocator.primary_.ReleaseFreeMemoryToOS(class_id);
+  release_mutex.Unlock();
+  if (UNLIKELY(flags()->stats)) {
+    CverStats &thread_stats = t->stats();
+    thread_stats.releases++;
+    thread_stats.released += released;
+  }
+  VERBOSE_PRINT("Released %zu bytes to the OS\n", released);
+}
+
 void CverDeallocate(StackTrace *stack, void *p) {
   CHECK(p);
+  if (UNLIKELY(ShadowMetadataEnabled())) {
+    ShadowDeallocate(p);
+    return;
+  }
   const void *beg = allocator.GetBlockBegin(p);
   if (beg != p) return;
   Metadata *meta = reinterpret_cast<Metadata *>(allocator.GetMetaData(p));
-  meta->requested_size = 0;
-  meta->type_table = 0;
-  meta->num_elements = 0;
+  if (!allocator.FromPrimary(p))
+    SetSecondaryPages((uptr)p, allocator.GetActuallyAllocatedSize(p), 0);
+  meta->SetUntyped(0);
 
   CverThread *t = GetCurrentThread();
   if (t) {
-    AllocatorCache *cache = GetAllocatorCache(&t->malloc_storage());
-    allocator.Deallocate(cache, p);
+    CverThreadLocalMallocStorage *ms = &t->malloc_storage();
+    uptr threshold = (uptr)flags()->release_to_os_threshold << 20;
+    if (threshold && allocator.FromPrimary(p))
+      ms->freed_since_release += allocator.GetActuallyAllocatedSize(p);
+    allocator.Deallocate(GetAllocatorCache(ms), p);
+    if (UNLIKELY(threshold && ms->freed_since_release >= threshold)) {
+      ms->freed_since_release = 0;
+      ReleaseFreeMemoryToOS(t);
+    }
   } else {
     SpinMutexLock l(&fallback_mutex);
     AllocatorCache *cache = &fallback_allocator_cache;
@@ -120,6 +247,16 @@ void *CverReallocate(StackTrace *stack, void *old_p, uptr new_size,
   if (!cver_initialized)
     InitCverIfNecessary();
 
+  if (UNLIKELY(ShadowMetadataEnabled())) {
+    if (!old_p)
+      return ShadowAllocate(new_size, alignment, zeroise);
+    if (!new_size) {
+      ShadowDeallocate(old_p);
+      return 0;
+    }
+    return ShadowReallocate(old_p, new_size);
+  }
+
   if (!old_p)
     return CverAllocate(stack, new_size, alignment, zeroise);
   if (!new_size) {
@@ -130,10 +267,13 @@ void *CverReallocate(StackTrace *stack, void *old_p, uptr new_size,
   if (old_beg != old_p) return 0;
 
   Metadata *meta = reinterpret_cast<Metadata*>(allocator.GetMetaData(old_p));
-  uptr old_size = meta->requested_size;
   uptr actually_allocated_size = allocator.GetActuallyAllocatedSize(old_p);
+  // Typed chunks do not keep their requested sizes.
+  uptr old_size = meta->IsTyped() ? actually_allocated_size
+                                  : meta->RequestedSize();
   if (new_size <= actually_allocated_size) {
-    meta->requested_size = new_size;
+    if (!meta->IsTyped())
+      meta->SetUntyped(new_size);
     return old_p;
   }
   uptr memcpy_size = Min(new_size, old_size);
@@ -146,9 +286,32 @@ void *CverReallocate(StackTrace *stack, void *old_p, uptr new_size,
   return new_p;
 }
 
+// Allocates a chunk and records its type in the metadata at once, which saves
+// the block-begin lookup of SetCverTypeTableAndNumElements().
+void *CverAllocateTyped(StackTrace *stack, uptr size, uptr alignment,
+                        void *TypeTable, uptr numElements) {
+  if (!cver_initialized)
+    InitCverIfNecessary();
+
+  if (UNLIKELY(ShadowMetadataEnabled())) {
+    void *p = ShadowAllocate(size, alignment, false);
+    if (p)
+      SetShadowTypeTable((uptr)p, TypeTable);
+    return p;
+  }
+
+  return CverAllocate(stack, size, alignment, false, (uptr)TypeTable,
+                      numElements);
+}
+
 ///////////////////////
 bool PointerIsDynamic(uptr p) {
-  return allocator.FromPrimary(reinterpret_cast<void *>(p));
+  if (UNLIKELY(ShadowMetadataEnabled())) {
+    Metadata *m = GetShadowMetaData(p);
+    return m && m->IsTyped();
+  }
+  return allocator.FromPrimary(reinterpret_cast<void *>(p)) ||
+         GetSecondaryBlockBegin(p);
 }
 
 void *GetAllocBegin(uptr p) {
@@ -156,53 +319,82 @@ void *GetAllocBegin(uptr p) {
 }
 
 CVER_INLINE void *GetBlockBeginAndMetaData(uptr p, Metadata **ppMetaData) {
-  return allocator.primary_.GetBlockBeginAndMetaData(
-    reinterpret_cast<void *>(p), reinterpret_cast<void**>(ppMetaData));
+  if (UNLIKELY(ShadowMetadataEnabled())) {
+    *ppMetaData = GetShadowMetaData(p);
+    return reinterpret_cast<void *>(p & ~((1ULL << kShadowGranuleShift) - 1));
+  }
+  if (LIKELY(allocator.FromPrimary(reinterpret_cast<void *>(p))))
+    return allocator.primary_.GetBlockBeginAndMetaData(
+      reinterpret_cast<void *>(p), reinterpret_cast<void**>(ppMetaData));
+
+  uptr beg = GetSecondaryBlockBegin(p);
+  if (!beg)
+    return 0;
+  *ppMetaData = GetCverMetaDataFromBegin(reinterpret_cast<void *>(beg));
+  return reinterpret_cast<void *>(beg);
 }
 
 void *GetAllocUserBegin(uptr p) {
-  return allocator.GetBlockBeginPrimary(reinterpret_cast<void *>(p));
+  if (UNLIKELY(ShadowMetadataEnabled()))
+    return reinterpret_cast<void *>(p & ~((1ULL << kShadowGranuleShift) - 1));
+  if (LIKELY(allocator.FromPrimary(reinterpret_cast<void *>(p))))
+    return allocator.GetBlockBeginPrimary(reinterpret_cast<void *>(p));
+  return reinterpret_cast<void *>(GetSecondaryBlockBegin(p));
 }
 
 Metadata *GetCverMetaDataFromBegin(void *beg) {
-  return (Metadata *)allocator.GetMetaDataPrimary(beg);
+  if (UNLIKELY(ShadowMetadataEnabled()))
+    return GetShadowMetaData(reinterpret_cast<uptr>(beg));
+  if (LIKELY(allocator.FromPrimary(beg)))
+    return (Metadata *)allocator.GetMetaDataPrimary(beg);
+  // The metadata of a secondary chunk follows its header, and is located
+  // without a lock.
+  return (Metadata *)allocator.secondary_.GetMetaData(beg);
 }
 
 Metadata *GetCverMetaData(void *p) {
   if (p == 0) return 0;
-  const void *beg = allocator.GetBlockBeginPrimary(p);
+  const void *beg = GetAllocUserBegin(reinterpret_cast<uptr>(p));
   if (beg == 0) return 0;
-  return (Metadata *)allocator.GetMetaDataPrimary(beg);
+  return GetCverMetaDataFromBegin(const_cast<void *>(beg));
 }
 
 bool SetCverTypeTableAndNumElements(uptr p, void *TypeTable, uptr numElements) {
-  Metadata *m = GetCverMetaData((void *)p);
+  if (UNLIKELY(ShadowMetadataEnabled()))
+    return SetShadowTypeTable(p, TypeTable);
+  void *beg = GetAllocUserBegin(p);
+  if (!beg) return false;
+  Metadata *m = GetCverMetaDataFromBegin(beg);
 
   if (!m) return false;
-  m->type_table = (uptr)TypeTable;
-  m->num_elements = (uptr)numElements;
+  // The chunk may be typed again, e.g., when a class-specific allocator reuses
+  // it for another object. A typed chunk no longer keeps its requested size,
+  // so the new type spans the whole chunk.
+  uptr size = m->IsTyped() ? allocator.GetActuallyAllocatedSize(beg)
+                           : m->RequestedSize();
+  SetMetaDataType(m, size, (uptr)TypeTable, numElements);
   return true;
 }
 
 void *GetCverTypeTable(uptr p) {
   Metadata *m = GetCverMetaData((void *)p);
   if (!m) return 0;
-  return (void*)m->type_table;
-}
-
-uptr GetCverArrayNumElements(uptr p) {
-  Metadata *m = GetCverMetaData((void *)p);
-  if (!m) return 0;
-  return (uptr)m->num_elements;
+  return (void*)m->TypeTable();
 }
 
 uptr AllocationSize(uptr p) {
+  if (UNLIKELY(ShadowMetadataEnabled()))
+    return ShadowAllocationSize((void *)p);
   Metadata *m = GetCverMetaData((void *)p);
   if (!m) return 0;
-  return m->requested_size;
+  if (m->IsTyped())
+    return allocator.GetActuallyAllocatedSize((void *)p);
+  return m->RequestedSize();
 }
 
 void PrintInternalAllocatorStats() {
+  if (ShadowMetadataEnabled())
+    return;
   allocator.PrintStats();
 }
 
@@ -9,17 +9,50 @@
 
 namespace __cver {
 
+// The metadata of a chunk is packed into a single word. A typed chunk keeps
+// its THTable, which is 8-byte aligned and below 2^47, with the tag bit set,
+// and the element size of an array (or 0) in the top 17 bits. An untyped
+// chunk keeps its requested size, so that __cver_handle_new() can compute the
+// element size when it types the chunk later.
 struct Metadata {
-  uptr requested_size;
-  uptr type_table;
-  uptr num_elements;
+  uptr word;
+
+  static const uptr kTypedTag = 1;
+  static const uptr kTypeTableBits = 47;
+  static const uptr kMaxElementSize = (1ULL << (64 - kTypeTableBits)) - 1;
+
+  bool IsTyped() const { return word & kTypedTag; }
+  uptr TypeTable() const {
+    if (!IsTyped())
+      return 0;
+    return word & ((1ULL << kTypeTableBits) - 1) & ~kTypedTag;
+  }
+  uptr ElementSize() const {
+    return IsTyped() ? word >> kTypeTableBits : 0;
+  }
+  // The requested size of an untyped chunk, or 0 if it is typed.
+  uptr RequestedSize() const { return IsTyped() ? 0 : word >> 1; }
+
+  void SetUntyped(uptr size) { word = size << 1; }
+  // Returns false if TypeTable or ElementSize do not fit in, leaving the chunk
+  // untyped. Casts on such chunks are unknown.
+  bool SetTyped(uptr TypeTable, uptr ElementSize) {
+    if (UNLIKELY((TypeTable & 7) || (TypeTable >> kTypeTableBits) ||
+                 ElementSize > kMaxElementSize))
+      return false;
+    word = TypeTable | kTypedTag | (ElementSize << kTypeTableBits);
+    return true;
+  }
 };
 
 void InitializeAllocator();
 
 struct CverThreadLocalMallocStorage {
   uptr quarantine_cache[16];
-  ALIGNED(8) uptr allocator_cache[96 * (512 * 8 + 16)];  // Opaque.
+  // Opaque; allocated on the first use, and freed by CommitBack().
+  void *allocator_cache;
+  // Bytes freed by the thread since the last release to the OS.
+  uptr freed_since_release;
   void CommitBack();
 private:
   // These objects are allocated via mmap() and are zero-initialized.
@@ -35,6 +68,8 @@ void *GetAllocUserBegin(uptr p);
 
 void *CverReallocate(StackTrace *stack, void *old_p, uptr new_size,
                      uptr alignment, bool zeroise);
+void *CverAllocateTyped(StackTrace *stack, uptr size, uptr alignment,
+                        void *TypeTable, uptr numElements);
 void CverDeallocate(StackTrace *stack, void *p);
 
 bool PointerIsDynamic(uptr p);
@@ -43,7 +78,6 @@ Metadata *GetCverMetaDataFromBegin(void *beg);
 Metadata *GetCverMetaData(void *p);
 bool SetCverTypeTableAndNumElements(uptr p, void *TypeTable, uptr numElements);
 void *GetCverTypeTable(uptr p);
-uptr GetCverArrayNumElements(uptr p);
 uptr AllocationSize(uptr p);
 
 uptr __sanitizer_get_allocated_size(const void *p);
@@ -0,0 +1,221 @@
+#ifndef CVER_ALLOCATOR_CACHE_H
+#define CVER_ALLOCATOR_CACHE_H
+
+#include "cver_common.h"
+#include "cver_stats.h"
+#include "sanitizer_common/sanitizer_allocator.h"
+#include "sanitizer_common/sanitizer_allocator_internal.h"
+
+namespace __cver {
+
+// A per-thread cache for SizeClassAllocator64, used in place of
+// SizeClassAllocatorLocalCache. The latter embeds the chunk arrays of all the
+// size classes, sized for the largest one, in every thread. Here the array
+// of a size class is allocated on its first use and sized for that class:
+// it holds MaxCached(class_id) chunks, and grows to twice that if the class
+// keeps refilling and draining. The arrays of the classes that did not go
+// to the allocator for a whole epoch are drained and freed.
+//
+// Like SizeClassAllocatorLocalCache, this must be valid in zero-initialized
+// state.
+template <class SizeClassAllocator>
+struct CverLocalCache {
+  typedef SizeClassAllocator Allocator;
+  typedef typename SizeClassAllocator::SizeClassMapT SizeClassMap;
+  typedef typename SizeClassMap::TransferBatch Batch;
+  static const uptr kNumClasses = SizeClassAllocator::kNumClasses;
+  // Slow-path operations (refills and drains) per epoch.
+  static const uptr kEpochLength = 4096;
+
+  void Init(AllocatorGlobalStats *s) {
+    stats_.Init();
+    if (s)
+      s->Register(&stats_);
+  }
+
+  void Destroy(SizeClassAllocator *allocator, AllocatorGlobalStats *s) {
+    Drain(allocator);
+    if (s)
+      s->Unregister(&stats_);
+  }
+
+  void *Allocate(SizeClassAllocator *allocator, uptr class_id) {
+    CHECK_NE(class_id, 0UL);
+    CHECK_LT(class_id, kNumClasses);
+    stats_.Add(AllocatorStatAllocated, SizeClassMap::Size(class_id));
+    PerClass *c = &per_class_[class_id];
+    if (UNLIKELY(c->count == 0))
+      Refill(allocator, class_id);
+    void *res = c->batch[--c->count];
+    PREFETCH(c->batch[c->count - 1]);
+    return res;
+  }
+
+  void Deallocate(SizeClassAllocator *allocator, uptr class_id, void *p) {
+    CHECK_NE(class_id, 0UL);
+    CHECK_LT(class_id, kNumClasses);
+    stats_.Sub(AllocatorStatAllocated, SizeClassMap::Size(class_id));
+    PerClass *c = &per_class_[class_id];
+    if (UNLIKELY(c->count == c->max_count))
+      MakeRoom(allocator, class_id);
+    c->batch[c->count++] = p;
+  }
+
+  // Returns all the cached chunks to the allocator, and frees the arrays.
+  void Drain(SizeClassAllocator *allocator) {
+    no_trim_++;
+    // The classes requiring separate transfer batches are smaller than the
+    // class of the batches, so the latter is drained after them.
+    for (uptr class_id = 1; class_id < kNumClasses; class_id++)
+      Release(allocator, class_id);
+    no_trim_--;
+  }
+
+  // Bytes of the cache, and the most it has taken.
+  uptr Footprint() const { return sizeof(*this) + footprint_; }
+  uptr PeakFootprint() const { return sizeof(*this) + peak_footprint_; }
+
+ private:
+  enum { kOpNone, kOpRefill, kOpDrain };
+  struct PerClass {
+    uptr count;
+    uptr max_count;
+    void **batch;
+    u32 last_epoch;
+    u32 last_op;
+  };
+  PerClass per_class_[kNumClasses];
+  AllocatorStats stats_;
+  // Bytes of the chunk arrays.
+  uptr footprint_;
+  uptr peak_footprint_;
+  uptr slow_ops_;
+  uptr no_trim_;
+  u32 epoch_;
+
+  static uptr MinCount(uptr class_id) {
+    return Max<uptr>(2, SizeClassMap::MaxCached(class_id));
+  }
+
+  static uptr MaxCount(uptr class_id) {
+    return Max(MinCount(class_id), 2 * SizeClassMap::MaxCached(class_id));
+  }
+
+  void Resize(PerClass *c, uptr max_count) {
+    void **batch = 0;
+    if (max_count) {
+      batch = (void **)InternalAlloc(max_count * sizeof(void *));
+      CHECK(batch);
+      internal_memcpy(batch, c->batch, c->count * sizeof(void *));
+    }
+    if (c->batch)
+      InternalFree(c->batch);
+    sptr delta = (sptr)(max_count - c->max_count) * sizeof(void *);
+    footprint_ += delta;
+    peak_footprint_ = Max(peak_footprint_, footprint_);
+    CVER_DEBUG_STMT(flags()->stats, {
+        CverStats &thread_stats = GetCurrentThreadStats();
+        thread_stats.allocatorCacheBytes += delta;
+        thread_stats.allocatorCachePeak =
+          Max(thread_stats.allocatorCachePeak, Footprint());
+        if (delta > 0)
+          thread_stats.allocatorCacheGrows++;
+        else
+          thread_stats.allocatorCacheTrims++;
+      });
+    c->batch = batch;
+    c->max_count = max_count;
+  }
+
+  // Starts a new epoch every kEpochLength slow-path operations, and releases
+  // the classes untouched during the last one. Not done while draining, as
+  // draining allocates transfer batches from this cache.
+  void MaybeTrim(SizeClassAllocator *allocator) {
+    if (LIKELY(++slow_ops_ < kEpochLength) || no_trim_)
+      return;
+    slow_ops_ = 0;
+    epoch_++;
+    no_trim_++;
+    for (uptr class_id = 1; class_id < kNumClasses; class_id++) {
+      PerClass *c = &per_class_[class_id];
+      if (c->batch && c->last_epoch + 1 < epoch_)
+        Release(allocator, class_id);
+    }
+    no_trim_--;
+  }
+
+  void Touch(PerClass *c, u32 op) {
+    c->last_epoch = epoch_;
+    c->last_op = op;
+  }
+
+  void Release(SizeClassAllocator *allocator, uptr class_id) {
+    PerClass *c = &per_class_[class_id];
+    while (c->count > 0)
+      Drain(allocator, class_id);
+    if (c->batch)
+      Resize(c, 0);
+    c->last_op = kOpNone;
+  }
+
+  NOINLINE void Refill(SizeClassAllocator *allocator, uptr class_id) {
+    MaybeTrim(allocator);
+    PerClass *c = &per_class_[class_id];
+    // Trimming may have refilled the class of the transfer batches.
+    if (c->count)
+      return;
+    if (!c->batch)
+      Resize(c, MinCount(class_id));
+    else if (c->last_op == kOpDrain && c->max_count < MaxCount(class_id))
+      Resize(c, MaxCount(class_id));
+    Touch(c, kOpRefill);
+    Batch *b = allocator->AllocateBatch(&stats_, this, class_id);
+    CHECK_GT(b->count, 0);
+    CHECK_LE(b->count, c->max_count);
+    for (uptr i = 0; i < b->count; i++)
+      c->batch[i] = b->batch[i];
+    c->count = b->count;
+    if (SizeClassMap::SizeClassRequiresSeparateTransferBatch(class_id))
+      Deallocate(allocator, SizeClassMap::ClassID(sizeof(Batch)), b);
+  }
+
+  NOINLINE void MakeRoom(SizeClassAllocator *allocator, uptr class_id) {
+    MaybeTrim(allocator);
+    PerClass *c = &per_class_[class_id];
+    if (!c->batch)
+      Resize(c, MinCount(class_id));
+    else if (c->count < c->max_count)
+      return;
+    else if (c->last_op == kOpRefill && c->max_count < MaxCount(class_id))
+      Resize(c, MaxCount(class_id));
+    else
+      Drain(allocator, class_id);
+    Touch(c, kOpDrain);
+  }
+
+  // Moves up to half of the array to the allocator.
+  NOINLINE void Drain(SizeClassAllocator *allocator, uptr class_id) {
+    PerClass *c = &per_class_[class_id];
+    Batch *b;
+    if (SizeClassMap::SizeClassRequiresSeparateTransferBatch(class_id)) {
+      no_trim_++;
+      b = (Batch*)Allocate(allocator, SizeClassMap::ClassID(sizeof(Batch)));
+      no_trim_--;
+    } else {
+      b = (Batch*)c->batch[0];
+    }
+    uptr cnt = Min(c->max_count / 2, c->count);
+    for (uptr i = 0; i < cnt; i++)
+      b->batch[i] = c->batch[i];
+    c->count -= cnt;
+    for (uptr i = 0; i < c->count; i++)
+      c->batch[i] = c->batch[i + cnt];
+    b->count = cnt;
+    CHECK_GT(b->count, 0);
+    allocator->DeallocateBatch(&stats_, class_id, b);
+  }
+};
+
+} // namespace __cver
+
+#endif // CVER_ALLOCATOR_CACHE_H
@@ -6,51 +6,60 @@
 
 namespace __cver {
 
-typedef uptr CacheKey;
-
-static const unsigned FirstCacheSize = 2048;
-static CacheKey FirstCache[FirstCacheSize];
-
-CVER_INLINE CacheKey *getSecondCacheBucket(CacheKey V) {
-  static const unsigned SecondCacheSize = 65537;
-  static CacheKey SecondCache[SecondCacheSize];
-
-  unsigned First = (V & 65535) ^ 1;
-  unsigned Probe = First;
-  for (int Tries = 5; Tries; --Tries) {
-    if (!SecondCache[Probe] || SecondCache[Probe] == V)
-      return &SecondCache[Probe];
-    Probe += ((V >> 16) & 65535) + 1;
-    if (Probe >= SecondCacheSize)
-      Probe -= SecondCacheSize;
+// The size of the inline cast cache. Should be matched with
+// CodeGenFunction::EmitTypeCastCheck().
+const unsigned VptrTypeCacheSize = 1024;
+
+/// \brief A cache of verified casts on polymorphic objects, probed inline by
+/// Clang-instrumented code. The cast is known to be good if
+/// \code
+///   __cver_vptr_type_cache[Hash % VptrTypeCacheSize] == Hash
+/// \endcode
+/// where Hash is hash_16_bytes(TargetHash ^ (AfterPtr - BeforePtr), vptr).
+/// Only filled by __cver_handle_cast_cache_miss().
+extern "C" SANITIZER_INTERFACE_ATTRIBUTE
+uptr __cver_vptr_type_cache[VptrTypeCacheSize];
+
+// A per-thread cache of verified (THTable, TargetHash) pairs. Both words are
+// stored so that distinct pairs never alias, and each set holds two ways with
+// the most recently inserted pair first.
+struct CverCastCacheEntry {
+  uptr TypeTable;
+  uptr Hash;
+};
+
+class CverCastCache {
+ public:
+  static const unsigned kNumSets = 2048;
+  static const unsigned kNumWays = 2;
+
+  CVER_INLINE bool Lookup(uptr TypeTable, uptr Hash) {
+    CverCastCacheEntry *Set = getSet(TypeTable, Hash);
+    for (unsigned i = 0; i < kNumWays; i++)
+      if (Set[i].TypeTable == TypeTable && Set[i].Hash == Hash)
+        return true;
+    return false;
   }
-  return &SecondCache[First];
-}
-
-CVER_INLINE bool IsInCache(CacheKey Key, CacheKey **pEvictSecondCacheBucket) {
-  // Check first cache.
-  if (FirstCache[Key % FirstCacheSize] == Key)
-    return true;
-
-  // Check second cache.
-  CacheKey *Bucket = getSecondCacheBucket(Key);
-  if (*Bucket == Key) {
-    // Update first cache.
-    FirstCache[Key % FirstCacheSize] = Key;
-    return true;
+
+  CVER_INLINE void Insert(uptr TypeTable, uptr Hash) {
+    CverCastCacheEntry *Set = getSet(TypeTable, Hash);
+    for (unsigned i = kNumWays - 1; i > 0; i--)
+      Set[i] = Set[i - 1];
+    Set[0].TypeTable = TypeTable;
+    Set[0].Hash = Hash;
+  }
+
+ private:
+  // NOTE: There is no constructor. It lives in CverThread, which is allocated
+  // via mmap() and is zero-initialized.
+  CVER_INLINE CverCastCacheEntry *getSet(uptr TypeTable, uptr Hash) {
+    // THTables are at least 8-byte aligned, so drop the low bits.
+    uptr Mix = (TypeTable >> 3) ^ Hash ^ (Hash >> 32);
+    return &Entries[(Mix & (kNumSets - 1)) * kNumWays];
   }
-  *pEvictSecondCacheBucket = Bucket;
-  return false;
-}
-
-// FIXME : Should not re-do getSecondCacheBucket
-CVER_INLINE void UpdateCache(CacheKey Key, CacheKey *EvictSecondCacheBucket) {
-  // Update the first cache.
-  FirstCache[Key % FirstCacheSize] = Key;
-
-  // Update the second cache.
-  *EvictSecondCacheBucket = Key;
-}
+
+  CverCastCacheEntry Entries[kNumSets * kNumWays];
+};
 
 } // namespace __cver
 
@@ -5,6 +5,9 @@
 #include "cver_thread.h"
 #include "cver_cache.h"
 #include "cver_stats.h"
+#include "cver_global_index.h"
+#include "cver_vptr_map.h"
+#include "cver_rbtree.h"
 
 #include "sanitizer_common/sanitizer_common.h"
 #include "sanitizer_common/sanitizer_flags.h"
@@ -14,6 +17,8 @@ using namespace __cver;
 
 rbtree cver_global_rbtree_root = 0;
 
+uptr __cver::__cver_vptr_type_cache[__cver::VptrTypeCacheSize];
+
 namespace __cver {
 
 // Compute the hash value without isSameLayout information.
@@ -37,10 +42,20 @@ struct CastHookArgs {
 // _ContainVector
 // ...
 // _HashVector
+// ...
+// _BaseSet
+// ...
+// _FlatContainVector
+// ...
+// _FlatHashes
+// ...
+// _TypeInfo       --> Type name (in a separate string section)
 // ------------
+//
+// Offsets and sizes are 32-bit, and all the other fields are 64-bit aligned.
 struct _ContainElem {
-  uptr offset;
-  uptr size;
+  u32 offset;
+  u32 size;
   uptr pTHTable;
 };
 
@@ -50,19 +65,88 @@ struct _ContainVector {
   // ...
 };
 
-struct _BaseElem {
-  uptr BaseHash;
-  uptr BaseOffset;
-};
-
+// The hashes of the owner and all its bases are packed in Hashes. At the end
+// of Hashes, their 32-bit offsets are located (padded to 64-bit), and then
+// _BaseSet.
 struct _HashVector {
   uptr numBases;
-  _BaseElem BaseElem[1];
-  // At the end of Hashes, mangledName array is located.
+  uptr Hashes[1];
+};
+
+// An open-addressed (linear probing) set of all hashes in _HashVector,
+// without isSameLayout bits. The number of slots is a power of two and at
+// least twice of numBases, so there is always an empty (zero) slot.
+struct _BaseSet {
+  uptr mask;
+  uptr Slots[1];
+  // At the end of Slots, _FlatContainVector is located.
+};
+
+// All nested containments flattened into disjoint segments sorted by offset.
+// The hashes (without isSameLayout bits) of all types reachable at a segment
+// are sorted in _FlatHashes::Hashes[hashIndex, hashIndex+numHashes).
+struct _FlatContainElem {
+  u32 offset;
+  u32 size;
+  u32 hashIndex;
+  u32 numHashes;
 };
 
+struct _FlatContainVector {
+  uptr numSegments;
+  _FlatContainElem Elem[1];
+  // At the end of Elem, _FlatHashes is located.
+};
+
+struct _FlatHashes {
+  uptr numHashes;
+  uptr Hashes[1];
+  // At the end of Hashes, _TypeInfo is located.
+};
+
+// Dense type ID and the cast bitmap of the link unit, assigned by CverTypeIds
+// pass under LTO. Both are zero if not assigned. The type name is only used
+// for reports, so it is not stored in the table.
+struct _TypeInfo {
+  uptr id;
+  uptr castBitmap;
+  const char *name;
+};
+
+// Bit (src-1) * numTypeIds + (dst-1) is set if dst is one of src or its bases.
+struct _CastBitmap {
+  uptr numTypeIds;
+  uptr Bits[1];
+};
+
+static CVER_INLINE u32 *getBaseOffsetsFromHashVector(_HashVector *hashVec) {
+  return (u32 *)&hashVec->Hashes[hashVec->numBases];
+}
+
+static CVER_INLINE _BaseSet *getBaseSetFromHashVector(_HashVector *hashVec) {
+  return (_BaseSet *)&getBaseOffsetsFromHashVector(hashVec)[
+    RoundUpTo(hashVec->numBases, 2)];
+}
+
+static CVER_INLINE _FlatContainVector *getFlatContainVectorFromHashVector(
+  _HashVector *hashVec) {
+  _BaseSet *baseSet = getBaseSetFromHashVector(hashVec);
+  return (_FlatContainVector *)&baseSet->Slots[baseSet->mask + 1];
+}
+
+static CVER_INLINE _FlatHashes *getFlatHashesFromFlatContainVector(
+  _FlatContainVector *flatVec) {
+  return (_FlatHashes *)&flatVec->Elem[flatVec->numSegments];
+}
+
+static CVER_INLINE _TypeInfo *getTypeInfoFromHashVector(_HashVector *hashVec) {
+  _FlatHashes *flatHashes = getFlatHashesFromFlatContainVector(
+    getFlatContainVectorFromHashVector(hashVec));
+  return (_TypeInfo *)&flatHashes->Hashes[flatHashes->numHashes];
+}
+
 static CVER_INLINE const char *getMangledNameFromHashVector(_HashVector *hashVec) {
-  return (const char *)&hashVec->BaseElem[hashVec->numBases];
+  return getTypeInfoFromHashVector(hashVec)->name;
 }
 
 static CVER_INLINE  _HashVector *getHashVectorFromContainVector(_ContainVector *containVec) {
@@ -74,8 +158,73 @@ static CVER_INLINE const char *getMangledNameFromContainVector(_ContainVector *c
   return getMangledNameFromHashVector(hashVec);
 }
 
-// If the TargetHash matches to any of a hash value in the hash table (including
-// all containments), for now we say it is a good casting.
+// The probing should be matched with CodeGenTHTables::constructBaseSet().
+static CVER_INLINE bool IsInBaseSet(_HashVector *hashVec, uptr TargetHash) {
+  _BaseSet *baseSet = getBaseSetFromHashVector(hashVec);
+  uptr hash = GetHashValue(TargetHash);
+  for (uptr i = (hash >> 1) & baseSet->mask; baseSet->Slots[i];
+       i = (i + 1) & baseSet->mask) {
+    if (baseSet->Slots[i] == hash)
+      return true;
+  }
+  return false;
+}
+
+// Test the base membership with the precomputed cast bitmap. It only works if
+// both types are assigned IDs in the same link unit.
+static CVER_INLINE bool IsInCastBitmap(_HashVector *hashVec,
+                                       _HashVector *targetHashVec) {
+  _TypeInfo *src = getTypeInfoFromHashVector(hashVec);
+  _TypeInfo *dst = getTypeInfoFromHashVector(targetHashVec);
+  if (!src->id || !dst->id || src->castBitmap != dst->castBitmap)
+    return false;
+
+  _CastBitmap *bitmap = (_CastBitmap *)src->castBitmap;
+  uptr bit = (src->id - 1) * bitmap->numTypeIds + (dst->id - 1);
+  return (bitmap->Bits[bit / 64] >> (bit % 64)) & 1;
+}
+
+// Binary-search the segment including Offset, and then the TargetHash in the
+// hashes reachable at the segment.
+static CVER_INLINE bool IsInFlatContainVector(_HashVector *hashVec,
+                                              uptr Offset, uptr TargetHash) {
+  _FlatContainVector *flatVec = getFlatContainVectorFromHashVector(hashVec);
+
+  // Find the last segment starting at or before Offset.
+  uptr lo = 0, hi = flatVec->numSegments;
+  while (lo < hi) {
+    uptr mid = (lo + hi) / 2;
+    if (flatVec->Elem[mid].offset <= Offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == 0)
+    return false;
+
+  _FlatContainElem *elem = &flatVec->Elem[lo - 1];
+  if (Offset - elem->offset >= elem->size)
+    return false;
+
+  VERBOSE_PRINT("\t\t Segment [%u][%u] with %u hashes\n",
+                elem->offset, elem->size, elem->numHashes);
+
+  uptr *hashes = &getFlatHashesFromFlatContainVector(flatVec)->Hashes[
+    elem->hashIndex];
+  uptr hash = GetHashValue(TargetHash);
+  lo = 0, hi = elem->numHashes;
+  while (lo < hi) {
+    uptr mid = (lo + hi) / 2;
+    if (hashes[mid] < hash)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo < elem->numHashes && hashes[lo] == hash;
+}
+
+// If the TargetHash matches to any of a hash value in the hash table, or in
+// the containments at the Pointer, for now we say it is a good casting.
 // TODO : Should check the offset of the pointer to see where it is actually
 // pointing to
 
@@ -96,52 +245,33 @@ static bool CheckCastValidity(uptr Pointer, uptr objBaseAddr, uptr TargetHash,
                 hashVec->numBases,
                 getMangledNameFromHashVector(hashVec));
 
-  if (!flags()->no_composition) {
-    for (unsigned i=0; i<containVec->numContainment; i++) {
-      _ContainElem *elem = (_ContainElem *)&containVec->ContainElem[i];
-
-      VERBOSE_PRINT("\t\t C[%d] : [%zu][%zu] %p : %s\n",
-                    i, elem->offset, elem->size, elem->pTHTable,
-                    elem->pTHTable ? getMangledNameFromContainVector(
-                      (_ContainVector*)elem->pTHTable) : 0);
-
-      // TODO : Optimize using  bit vectors.
-      if (Pointer >= objBaseAddr + elem->offset &&
-          Pointer < objBaseAddr + elem->offset + elem->size &&
-          elem->pTHTable) {
-        _ContainVector *nestedContainVec = (_ContainVector *)elem->pTHTable;
-
-        _HashVector *nestedHashVec =
-          getHashVectorFromContainVector(nestedContainVec);
-
-        // If the given pointer is in the range of containment,
-        // let the corresponding pTHTable handle this case additionally.
-        VERBOSE_PRINT("\t\t\t nested with %p %p\n", nestedContainVec,
-                      nestedHashVec);
-        matched = CheckCastValidity(Pointer, objBaseAddr + elem->offset,
-                                    TargetHash, nestedContainVec,
-                                    nestedHashVec);
-
-        if (matched)
-          return true; // Matched from the hash in the containment table.
+  CVER_DEBUG_STMT(flags()->verbose, {
+      for (unsigned i=0; i<containVec->numContainment; i++) {
+        _ContainElem *elem = (_ContainElem *)&containVec->ContainElem[i];
+        Printf("\t\t C[%d] : [%u][%u] %p : %s\n",
+               i, elem->offset, elem->size, elem->pTHTable,
+               elem->pTHTable ? getMangledNameFromContainVector(
+                 (_ContainVector*)elem->pTHTable) : 0);
       }
-    }
+    });
+
+  // All nested containments are flattened, so a single lookup covers the
+  // containments of containments as well.
+  if (!flags()->no_composition && Pointer >= objBaseAddr &&
+      IsInFlatContainVector(hashVec, Pointer - objBaseAddr, TargetHash)) {
+    VERBOSE_PRINT("\t\t matched in containments\n");
+    return true;
   }
 
-  for (unsigned i=0; i<hashVec->numBases; i++) {
-    uptr hash = hashVec->BaseElem[i].BaseHash;
-    uptr offset = hashVec->BaseElem[i].BaseOffset;
+  CVER_DEBUG_STMT(flags()->verbose, {
+      for (unsigned i=0; i<hashVec->numBases; i++)
+        Printf("\t\t H[%d] : [%u] [%zu]\n", i,
+               getBaseOffsetsFromHashVector(hashVec)[i], hashVec->Hashes[i]);
+    });
 
-    VERBOSE_PRINT("\t\t H[%d] : [%zu] [%zu]\n", i, offset, hash);
-    if (hash == 0) break;
-
-    // if (GetHashValue(TargetHash) == GetHashValue(hash) &&
-    //     offset == (objBaseAddr - Pointer)) {
-    if (GetHashValue(TargetHash) == GetHashValue(hash)) {
-      matched = true;
-      break;
-    }
-  }
+  // if (GetHashValue(TargetHash) == GetHashValue(hash) &&
+  //     offset == (objBaseAddr - Pointer)) {
+  matched = IsInBaseSet(hashVec, TargetHash);
 
   if (!matched) {
     VERBOSE_PRINT("\t\t not matched!\n");
@@ -191,8 +321,50 @@ void __cver_handle_new(NewHookArgs *Data, uptr Pointer, uptr numElements) {
     });
 }
 
-static CVER_INLINE CacheKey computeCacheKey(_ContainVector *vec, uptr hash) {
-  return (uptr)vec ^ (hash << 32);
+// Allocates an object of TypeTable for operator new (or new[]) and records
+// its type in the same step, instead of the separate __cver_handle_new().
+static CVER_INLINE void *CverNewTyped(uptr size, void *TypeTable,
+                                      uptr numElements) {
+  CVER_DEBUG_STMT(flags()->stats, {
+      CverStats &thread_stats = GetCurrentThreadStats();
+      thread_stats.numNew++;
+      thread_stats.numNewCurrent++;
+      if (thread_stats.numNewCurrent > thread_stats.numNewPeak)
+        thread_stats.numNewPeak = thread_stats.numNewCurrent;
+    });
+
+  CVER_DEBUG_STMT(flags()->no_check || flags()->no_handle_new, {
+      return CverReallocate(0, 0, size, sizeof(u64), false);
+    });
+
+  void *Pointer = CverAllocateTyped(0, size, sizeof(u64), TypeTable,
+                                    numElements);
+
+  VERBOSE_PRINT(
+    "%p : %s [%d]\n", Pointer,
+    getMangledNameFromContainVector((_ContainVector*)TypeTable),
+    numElements);
+
+  CVER_DEBUG_STMT(flags()->new_stacktrace, {
+    GET_CALLER_PC_BP_SP;
+    MaybePrintStackTrace(sp, pc, bp);
+    });
+
+  CVER_DEBUG_STMT(flags()->stats, {
+      CverStats &thread_stats = GetCurrentThreadStats();
+      thread_stats.numHandleNew++;
+    });
+  return Pointer;
+}
+
+extern "C" SANITIZER_INTERFACE_ATTRIBUTE
+void *__cver_new_typed(uptr size, void *TypeTable, uptr numElements) {
+  return CverNewTyped(size, TypeTable, numElements);
+}
+
+extern "C" SANITIZER_INTERFACE_ATTRIBUTE
+void *__cver_new_array_typed(uptr size, void *TypeTable, uptr numElements) {
+  return CverNewTyped(size, TypeTable, numElements);
 }
 
 // return 0 : Bad casting, so ignore static_cast.
@@ -202,10 +374,19 @@ static CVER_INLINE CacheKey computeCacheKey(_ContainVector *vec, uptr hash) {
 #define GOOD_CAST_RET      1
 #define UNKNOWN_CAST_RET   1
 
-enum PointerLocation {LOC_UNKNOWN, LOC_DYNAMIC, LOC_STACK, LOC_GLOBAL};
-  
-extern "C" SANITIZER_INTERFACE_ATTRIBUTE
-int __cver_handle_cast(CastHookArgs *Data, uptr BeforePtr, uptr AfterPtr) {
+enum PointerLocation {LOC_UNKNOWN, LOC_DYNAMIC, LOC_STACK, LOC_GLOBAL,
+                      LOC_VPTR};
+
+// pCacheable is set if the cast is verified as a good casting on the pointer
+// to the beginning of the allocated object. Such a result only depends on the
+// allocated type, which is identified by the vptr for polymorphic objects, and
+// thus can be cached in __cver_vptr_type_cache.
+//
+// If isPolymorphic is set, BeforePtr points to a polymorphic object, and the
+// allocated type is first looked up with its vptr.
+static CVER_INLINE int HandleCast(CastHookArgs *Data, uptr BeforePtr,
+                                  uptr AfterPtr, bool isPolymorphic,
+                                  bool *pCacheable) {
   CVER_DEBUG_STMT(flags()->no_check, {
       return UNKNOWN_CAST_RET;
     });
@@ -226,10 +407,24 @@ int __cver_handle_cast(CastHookArgs *Data, uptr BeforePtr, uptr AfterPtr) {
   
   // Check if it is allocated in the heap.
   _ContainVector *containVec = 0;
-  uptr numElements = 0;
-  uptr userRequestedSize = 0;
+  // The size of an array element, or 0 if it is not an array.
+  uptr elementSize = 0;
   PointerLocation pointerLocation = LOC_UNKNOWN;
 
+  /////////////////////////////////////////////////
+  // POLYMORPHIC OBJECTS
+  // The vptr identifies the most-derived type and where the object begins,
+  // wherever the object is allocated.
+  if (isPolymorphic && !flags()->no_vptr_map) {
+    VptrMapEntry *entry = LookupVptr(*(uptr *)BeforePtr);
+    if (entry) {
+      VERBOSE_PRINT("Located vptr entry %p for %p\n", entry, BeforePtr);
+      containVec = (_ContainVector *)entry->TypeTable;
+      userAllocBeg = BeforePtr - entry->BaseOffset;
+      pointerLocation = LOC_VPTR;
+    }
+  }
+
   /////////////////////////////////////////////////
   // STACK POINTERS
   CverThread *cverThread = GetCurrentThread();
@@ -242,8 +437,7 @@ int __cver_handle_cast(CastHookArgs *Data, uptr BeforePtr, uptr AfterPtr) {
         VERBOSE_PRINT("Located stack bucket %p for %p\n", bucket, BeforePtr);
         containVec = (_ContainVector *)bucket->TypeTable;
         if (containVec) {
-          numElements = 0;
-          userRequestedSize = 0;
+          elementSize = 0;
           pointerLocation = LOC_STACK;
         }
       }
@@ -256,13 +450,26 @@ int __cver_handle_cast(CastHookArgs *Data, uptr BeforePtr, uptr AfterPtr) {
         containVec = (_ContainVector *)rbtree_lookup_range(t, BeforePtr,
                                                            &userAllocBeg);
         if (containVec) {
-          numElements = 0;
-          userRequestedSize = 0;
+          elementSize = 0;
           pointerLocation = LOC_STACK;
         }
       }
-    }
 #endif // CVER_USE_STACK_RBTREE
+
+#ifdef CVER_USE_SHADOW_STACK
+      ShadowStackEntry *entry = cverThread->shadow_stack.Lookup(
+        BeforePtr, GetShadowStackWatermark(cverThread));
+      if (entry) {
+        // Allocated in the stack.
+        VERBOSE_PRINT("Located shadow stack entry %p for %p\n", entry,
+                      BeforePtr);
+        containVec = (_ContainVector *)entry->TypeTable;
+        userAllocBeg = entry->Addr;
+        elementSize = 0;
+        pointerLocation = LOC_STACK;
+      }
+#endif // CVER_USE_SHADOW_STACK
+    }
     
     // If the pointer points to the stack but we failed to locate the THTable,
     // there's no point to try more on dynamic or global.
@@ -280,11 +487,10 @@ int __cver_handle_cast(CastHookArgs *Data, uptr BeforePtr, uptr AfterPtr) {
     if (userAllocBeg && m) {
       // Allocated in the heap
       VERBOSE_PRINT("Located metadata %p for %p\n", m, BeforePtr);
-      containVec = (_ContainVector *)m->type_table;
+      containVec = (_ContainVector *)m->TypeTable();
       if (!containVec) // This is not the dynamic object we are tracing.
         return UNKNOWN_CAST_RET;
-      numElements = m->num_elements;
-      userRequestedSize = m->requested_size;
+      elementSize = m->ElementSize();
       pointerLocation = LOC_DYNAMIC;
     } else {
       // Early bail out.
@@ -295,8 +501,12 @@ int __cver_handle_cast(CastHookArgs *Data, uptr BeforePtr, uptr AfterPtr) {
   /////////////////////////////////////////////////
   // GLOBAL POINTERS
   if (!containVec && !flags()->no_global) {
-    containVec = (_ContainVector *)rbtree_lookup_range(
-      cver_global_rbtree_root, BeforePtr, &userAllocBeg);
+    containVec = (_ContainVector *)LookupGlobal(BeforePtr, &userAllocBeg);
+    // The objects registered one by one by __cver_handle_global_var().
+    if (!containVec && cver_global_rbtree_root &&
+        cver_global_rbtree_root->root)
+      containVec = (_ContainVector *)rbtree_lookup_range(
+        cver_global_rbtree_root, BeforePtr, &userAllocBeg);
     pointerLocation = LOC_GLOBAL;
   }
 
@@ -333,27 +543,41 @@ int __cver_handle_cast(CastHookArgs *Data, uptr BeforePtr, uptr AfterPtr) {
     case LOC_GLOBAL:
       thread_stats.globalCasts++;
       break;
+    case LOC_VPTR:
+      thread_stats.vptrCasts++;
+      break;
     default:
       thread_stats.unknownCasts++;
       break;
     }
     });
 
-  // Check if it is cached results.
-  CacheKey Key;
-  CacheKey *EvictSecondCacheBucket;
-  if (LIKELY(!flags()->no_cache)) {
-    Key = computeCacheKey(containVec, Data->Hash);
-    if (IsInCache(Key, &EvictSecondCacheBucket)) {
+  // THTables are unique per type (see CodeGenTHTables::GenerateTypeHierarchy),
+  // so casting onto the allocated type is good without any hashing. The owner
+  // hash is always in the base set, so this doesn't change the results.
+  if ((uptr)containVec == (uptr)Data->TypeTable) {
+    VERBOSE_PRINT("\t Same THTable\n");
+    *pCacheable = (elementSize == 0 && BeforePtr == userAllocBeg);
+    return GOOD_CAST_RET;
+  }
+
+  // Check if it is cached results. Threads without CverThread don't cache.
+  CverCastCache *cache = 0;
+  if (LIKELY(!flags()->no_cache) && cverThread) {
+    cache = &cverThread->cast_cache();
+    if (cache->Lookup((uptr)containVec, Data->Hash)) {
       // Checked results found in cache.
       VERBOSE_PRINT("\t Cache matched\n");
 
       CVER_DEBUG_STMT(flags()->stats, {
-        CverStats &thread_stats = GetCurrentThreadStats();
-        thread_stats.cache_hits++;
+        cverThread->stats().cache_hits++;
         });
+      *pCacheable = (elementSize == 0 && BeforePtr == userAllocBeg);
       return GOOD_CAST_RET;
     }
+    CVER_DEBUG_STMT(flags()->stats, {
+      cverThread->stats().cache_misses++;
+      });
   }
 
   _HashVector *hashVec = getHashVectorFromContainVector(containVec);
@@ -361,10 +585,23 @@ int __cver_handle_cast(CastHookArgs *Data, uptr BeforePtr, uptr AfterPtr) {
 
   VERBOSE_PRINT("\t Allocated as %s\n", allocTypeName);
 
-  if (numElements > 0) {
-    CHECK_EQ(userRequestedSize%numElements, 0);
+  _ContainVector *targetContainVec = (_ContainVector *)Data->TypeTable;
+  _HashVector *targetHashVec = getHashVectorFromContainVector(targetContainVec);
+
+  // Whole-program (LTO) builds answer the base membership with a bit test.
+  if (!flags()->no_cast_bitmap && IsInCastBitmap(hashVec, targetHashVec)) {
+    VERBOSE_PRINT("\t Cast bitmap matched\n");
+    CVER_DEBUG_STMT(flags()->stats, {
+        GetCurrentThreadStats().bitmap_hits++;
+      });
+    if (cache)
+      cache->Insert((uptr)containVec, Data->Hash);
+    *pCacheable = (elementSize == 0 && BeforePtr == userAllocBeg);
+    return GOOD_CAST_RET;
+  }
+
+  if (elementSize > 0) {
     CHECK(BeforePtr >= userAllocBeg);
-    uptr elementSize = userRequestedSize / numElements;
     userAllocBeg = BeforePtr - (BeforePtr-userAllocBeg) % elementSize;
     VERBOSE_PRINT("\t\t userBeg adjusted: %p with elementSize %d\n",
                   userAllocBeg, elementSize);
@@ -374,21 +611,18 @@ int __cver_handle_cast(CastHookArgs *Data, uptr BeforePtr, uptr AfterPtr) {
 
   if (matched) {
     // Update Cache.
-    if (LIKELY(!flags()->no_cache))
-      UpdateCache(Key, EvictSecondCacheBucket);
+    if (cache)
+      cache->Insert((uptr)containVec, Data->Hash);
+    *pCacheable = (BeforePtr == userAllocBeg);
     return GOOD_CAST_RET;
   }
 
-  _ContainVector *targetContainVec = (_ContainVector *)Data->TypeTable;
-  _HashVector *targetHashVec = getHashVectorFromContainVector(targetContainVec);
-
   // Check if the target class has any base classes with the same layout. If it
   // is, check the casting validity onto those same layout classes as well.
   if (LIKELY(!flags()->empty_inherit)) {
     // Trying to match empty inherit cases too.
     for (unsigned i=0; i<targetHashVec->numBases; i++) {
-      // uptr hash = targetHashVec->Hashes[i];
-      uptr hash = targetHashVec->BaseElem[i].BaseHash;
+      uptr hash = targetHashVec->Hashes[i];
 
       if (IsSameLayout(hash)) {
         VERBOSE_PRINT("\t\t Found the same layout %zu\n", hash);
@@ -399,8 +633,9 @@ int __cver_handle_cast(CastHookArgs *Data, uptr BeforePtr, uptr AfterPtr) {
         if (targetMatched) {
           VERBOSE_PRINT("\t\t Matched with the same layout %zu\n", hash);
           // Update Cache.
-          if (LIKELY(!flags()->no_cache))
-            UpdateCache(Key, EvictSecondCacheBucket);
+          if (cache)
+            cache->Insert((uptr)containVec, Data->Hash);
+          *pCacheable = (BeforePtr == userAllocBeg);
           return GOOD_CAST_RET;
         }
       }
@@ -433,6 +668,29 @@ int __cver_handle_cast(CastHookArgs *Data, uptr BeforePtr, uptr AfterPtr) {
   return UNKNOWN_CAST_RET;
 }
 
+extern "C" SANITIZER_INTERFACE_ATTRIBUTE
+int __cver_handle_cast(CastHookArgs *Data, uptr BeforePtr, uptr AfterPtr) {
+  bool cacheable = false;
+  return HandleCast(Data, BeforePtr, AfterPtr, false, &cacheable);
+}
+
+// Invoked by the inline cache probe on polymorphic objects (see
+// CodeGenFunction::EmitTypeCastCheck()) if CacheHash is not found in
+// __cver_vptr_type_cache.
+extern "C" SANITIZER_INTERFACE_ATTRIBUTE
+int __cver_handle_cast_cache_miss(CastHookArgs *Data, uptr BeforePtr,
+                                  uptr AfterPtr, uptr CacheHash) {
+  bool cacheable = false;
+  int res = HandleCast(Data, BeforePtr, AfterPtr, true, &cacheable);
+
+  if (cacheable && LIKELY(!flags()->no_cache)) {
+    VERBOSE_PRINT("\t Caching %zu for vptr %p\n", CacheHash,
+                  *(uptr *)BeforePtr);
+    __cver_vptr_type_cache[CacheHash % VptrTypeCacheSize] = CacheHash;
+  }
+  return res;
+}
+
 extern "C" SANITIZER_INTERFACE_ATTRIBUTE
 void __cver_handle_stack_enter(NewHookArgs *Data, uptr Pointer,
                                uptr numElements, uptr AllocSize) {
@@ -474,6 +732,16 @@ void __cver_handle_stack_enter(NewHookArgs *Data, uptr Pointer,
   k.size = AllocSize;
   rbtree_insert(t, k, Data->TypeTable);
 #endif // CVER_USE_STACK_RBTREE
+
+#ifdef CVER_USE_SHADOW_STACK
+  CverThread *t = GetCurrentThread();
+  if (!t)
+    return;
+  if (UNLIKELY(!t->shadow_stack.Push(Pointer, AllocSize,
+                                     (uptr)Data->TypeTable,
+                                     GetShadowStackWatermark(t))))
+    VERBOSE_PRINT("\t Shadow stack is full for %p\n", Pointer);
+#endif // CVER_USE_SHADOW_STACK
   return;
 }
 
@@ -518,9 +786,30 @@ void __cver_handle_stack_exit(NewHookArgs *Data, uptr Pointer) {
   k.size = 0; // Doesn't matter.
   rbtree_delete(t, k);
 #endif // CVER_USE_STACK_RBTREE
+
+#ifdef CVER_USE_SHADOW_STACK
+  CverThread *t = GetCurrentThread();
+  if (!t)
+    return;
+  if (UNLIKELY(!t->shadow_stack.Pop(Pointer, GetShadowStackWatermark(t))))
+    VERBOSE_PRINT("\t Failed to pop shadow stack entry for %p\n", Pointer);
+#endif // CVER_USE_SHADOW_STACK
   return;
 }
 
+static void RegisterGlobal(uptr Pointer, uptr TypeTable, uptr AllocSize) {
+  if (!Pointer)
+    return;
+
+  VERBOSE_PRINT( "%p : %p %zu for %s\n", Pointer, TypeTable, AllocSize,
+    getMangledNameFromContainVector((_ContainVector*)TypeTable));
+
+  KEY k;
+  k.addr = Pointer;
+  k.size = AllocSize;
+  rbtree_insert(cver_global_rbtree_root, k, (void*)TypeTable);
+}
+
 extern "C" SANITIZER_INTERFACE_ATTRIBUTE
 void __cver_handle_global_var(uptr Pointer, uptr TypeTable, uptr AllocSize) {
   
@@ -537,17 +826,83 @@ void __cver_handle_global_var(uptr Pointer, uptr TypeTable, uptr AllocSize) {
   InitCverIfNecessary();
 #endif
 
-  if (!Pointer)
-    return;
-  
-  VERBOSE_PRINT( "%p : %p %zu for %s\n", Pointer, TypeTable, AllocSize,
-    getMangledNameFromContainVector((_ContainVector*)TypeTable));
-
-  KEY k;
-  k.addr = Pointer;
-  k.size = AllocSize;
-  rbtree_insert(cver_global_rbtree_root, k, (void*)TypeTable);
+  RegisterGlobal(Pointer, TypeTable, AllocSize);
   return;
 }
 
+// Invoked once per module with all of its global objects (see
+// CodeGenModule::EmitCverGlobalRegistration()).
+extern "C" SANITIZER_INTERFACE_ATTRIBUTE
+void __cver_register_globals(GlobalRecord *Globals, uptr NumGlobals) {
+  CVER_DEBUG_STMT(flags()->no_check, {
+      return;
+    });
+
+  CVER_DEBUG_STMT(flags()->no_global, {
+      return;
+    });
+
+  // Make sure Cver runtime is initialized.
+#ifndef CVER_USE_PREINIT_ARRAY
+  InitCverIfNecessary();
+#endif
+
+  for (uptr i = 0; i < NumGlobals; i++)
+    VERBOSE_PRINT( "%p : %p %zu for %s\n", Globals[i].Addr,
+      Globals[i].TypeTable, Globals[i].Size,
+      getMangledNameFromContainVector((_ContainVector*)Globals[i].TypeTable));
+
+  RegisterGlobalModule(Globals, NumGlobals);
+}
+
+// Invoked when the module registered the globals is unloaded.
+extern "C" SANITIZER_INTERFACE_ATTRIBUTE
+void __cver_unregister_globals(GlobalRecord *Globals, uptr NumGlobals) {
+  CVER_DEBUG_STMT(flags()->no_check, {
+      return;
+    });
+
+  CVER_DEBUG_STMT(flags()->no_global, {
+      return;
+    });
+
+  UnregisterGlobalModule(Globals, NumGlobals);
+}
+
+// Invoked once per module with the address points of all the vtables emitted
+// in it (see CodeGenModule::EmitCverVTableRegistration()).
+extern "C" SANITIZER_INTERFACE_ATTRIBUTE
+void __cver_register_vtables(VTableRecord *VTables, uptr NumVTables) {
+  CVER_DEBUG_STMT(flags()->no_check, {
+      return;
+    });
+
+  // Make sure Cver runtime is initialized.
+#ifndef CVER_USE_PREINIT_ARRAY
+  InitCverIfNecessary();
+#endif
+
+  for (uptr i = 0; i < NumVTables; i++) {
+    VERBOSE_PRINT("vtable %p : %p +%zu for %s\n", VTables[i].AddressPoint,
+      VTables[i].TypeTable, VTables[i].BaseOffset,
+      getMangledNameFromContainVector((_ContainVector*)VTables[i].TypeTable));
+    RegisterVptr(VTables[i].AddressPoint, VTables[i].TypeTable,
+                 VTables[i].BaseOffset);
+  }
+}
+
+// Invoked when the module registered the vtables is unloaded.
+extern "C" SANITIZER_INTERFACE_ATTRIBUTE
+void __cver_unregister_vtables(VTableRecord *VTables, uptr NumVTables) {
+  CVER_DEBUG_STMT(flags()->no_check, {
+      return;
+    });
+
+  for (uptr i = 0; i < NumVTables; i++) {
+    VERBOSE_PRINT("unregister vtable %p : %p\n", VTables[i].AddressPoint,
+                  VTables[i].TypeTable);
+    UnregisterVptr(VTables[i].AddressPoint, VTables[i].TypeTable);
+  }
+}
+
 } // namespace __cver
@@ -22,6 +22,22 @@ namespace __cver {
 /// \brief An opaque handle to a value.
 typedef uptr ValueHandle;
 
+// A global object registered by __cver_register_globals(). The layout should
+// be matched with CodeGenModule::EmitCverGlobalRegistration().
+struct GlobalRecord {
+  uptr Addr;
+  uptr Size;
+  uptr TypeTable;
+};
+
+// A vtable address point registered by __cver_register_vtables(). The layout
+// should be matched with CodeGenModule::getCverVTableRecordTy().
+struct VTableRecord {
+  uptr AddressPoint;
+  uptr TypeTable;
+  uptr BaseOffset;
+};
+
 } // namespace __cver
 
 #endif // CVER_COMMON_H
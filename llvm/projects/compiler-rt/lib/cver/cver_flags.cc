@@ -39,6 +39,12 @@ static void ParseFlagsFromString(Flags *f, const char *str) {
             "Do not free the memory from allocators");
   ParseFlag(str, &f->no_cache, "no_cache",
             "Disable type table searching cache");
+  ParseFlag(str, &f->no_cast_bitmap, "no_cast_bitmap",
+            "Disable the link-time cast bitmap");
+  ParseFlag(str, &f->no_vptr_map, "no_vptr_map",
+            "Disable locating polymorphic objects by vptrs (objects allocated "
+            "without their types, see -fsanitize-cver-no-vptr-map, are then "
+            "not checked)");
   ParseFlag(str, &f->no_global, "no_global",
             "Disable global object racing");
   ParseFlag(str, &f->no_stack, "no_stack",
@@ -63,6 +69,12 @@ static void ParseFlagsFromString(Flags *f, const char *str) {
             "Print statistics at exit");
   ParseFlag(str, &f->nullify, "nullify",
             "Return null pointers on bad-casting");
+  ParseFlag(str, &f->shadow_metadata, "shadow_metadata",
+            "Keep the application's allocator, and type heap objects in "
+            "shadow memory");
+  ParseFlag(str, &f->release_to_os_threshold, "release_to_os_threshold",
+            "Return the free pages of the allocator to the OS every time "
+            "this many megabytes are freed by a thread (0 to disable)");
 }
 
 void InitializeFlags() {
@@ -79,6 +91,10 @@ void InitializeFlags() {
   f->no_free = false;
   // Disable type table searching cache.
   f->no_cache = false;
+  // Disable the link-time cast bitmap.
+  f->no_cast_bitmap = false;
+  // Disable locating polymorphic objects by vptrs.
+  f->no_vptr_map = false;
   // Disable global object tracing.
   f->no_global = false;
   // Disable stack object tracing.
@@ -103,6 +119,10 @@ void InitializeFlags() {
   f->stats = false;
   // Return null pointers on bad-casting.
   f->nullify = false;
+  // Keep the application's allocator, and type heap objects in shadow memory.
+  f->shadow_metadata = false;
+  // Return free allocator pages to the OS every 64M freed by a thread.
+  f->release_to_os_threshold = 64;
   
 
   // Override from compile definition.
@@ -9,6 +9,8 @@ struct Flags {
   bool no_check;
   bool no_free;
   bool no_cache;
+  bool no_cast_bitmap;
+  bool no_vptr_map;
   bool no_global;
   bool no_stack;
   bool no_composition;
@@ -21,6 +23,8 @@ struct Flags {
   bool new_stacktrace;
   bool stats;
   bool nullify;
+  bool shadow_metadata;
+  int release_to_os_threshold;
 };
 
 extern Flags cver_flags;
@@ -0,0 +1,68 @@
+#include "cver_global_index.h"
+
+#include "sanitizer_common/sanitizer_mutex.h"
+
+namespace __cver {
+
+atomic_uintptr_t cver_global_modules[kMaxGlobalModules];
+atomic_uintptr_t cver_num_global_module_slots;
+
+static StaticSpinMutex global_modules_mu;
+
+static bool CompareGlobalRecords(const GlobalRecord &a, const GlobalRecord &b) {
+  return a.Addr < b.Addr;
+}
+
+void RegisterGlobalModule(GlobalRecord *Globals, uptr NumGlobals) {
+  if (!NumGlobals)
+    return;
+
+  // Sort a copy, as the records of the module are read-only.
+  GlobalModule *M = (GlobalModule *)MmapOrDie(
+    sizeof(GlobalModule) + (NumGlobals - 1) * sizeof(GlobalRecord),
+    "CverGlobalModule");
+  M->Key = Globals;
+  M->NumGlobals = NumGlobals;
+  M->NumRecords = 0;
+  for (uptr i = 0; i < NumGlobals; i++)
+    if (Globals[i].Addr && Globals[i].Size)
+      M->Records[M->NumRecords++] = Globals[i];
+  InternalSort(&M->Records, M->NumRecords, CompareGlobalRecords);
+
+  M->Beg = M->NumRecords ? M->Records[0].Addr : 0;
+  M->End = M->Beg;
+  for (uptr i = 0; i < M->NumRecords; i++)
+    M->End = Max(M->End, M->Records[i].Addr + M->Records[i].Size);
+
+  SpinMutexLock l(&global_modules_mu);
+  uptr n = atomic_load(&cver_num_global_module_slots, memory_order_relaxed);
+  uptr i = 0;
+  for (; i < n; i++)
+    if (!atomic_load(&cver_global_modules[i], memory_order_relaxed))
+      break;
+  if (i == kMaxGlobalModules) {
+    Report("CastVerifier: too many modules with global objects\n");
+    Die();
+  }
+
+  atomic_store(&cver_global_modules[i], (uptr)M, memory_order_release);
+  if (i == n)
+    atomic_store(&cver_num_global_module_slots, n + 1, memory_order_release);
+}
+
+void UnregisterGlobalModule(GlobalRecord *Globals, uptr NumGlobals) {
+  SpinMutexLock l(&global_modules_mu);
+  uptr n = atomic_load(&cver_num_global_module_slots, memory_order_relaxed);
+  for (uptr i = 0; i < n; i++) {
+    GlobalModule *M = (GlobalModule *)atomic_load(&cver_global_modules[i],
+                                                  memory_order_relaxed);
+    if (M && M->Key == Globals) {
+      // The same module registered the records.
+      CHECK_EQ(M->NumGlobals, NumGlobals);
+      atomic_store(&cver_global_modules[i], 0, memory_order_release);
+      return;
+    }
+  }
+}
+
+} // namespace __cver
@@ -0,0 +1,77 @@
+#ifndef CVER_GLOBAL_INDEX_H
+#define CVER_GLOBAL_INDEX_H
+
+#include "cver_common.h"
+#include "cver_internal.h"
+#include "sanitizer_common/sanitizer_atomic.h"
+#include "sanitizer_common/sanitizer_common.h"
+
+namespace __cver {
+
+// The global objects registered by a module, sorted by their addresses.
+// Key and NumGlobals are the record array passed by the module and its
+// length, which identify it on unregistration. A GlobalModule is immutable
+// once published.
+struct GlobalModule {
+  GlobalRecord *Key;
+  uptr NumGlobals;
+  uptr Beg;
+  uptr End;
+  uptr NumRecords;
+  GlobalRecord Records[1];
+};
+
+// The modules are published in a fixed array of slots, so that lookups never
+// take a lock. An unloaded module is dropped by clearing its slot, but its
+// GlobalModule is never unmapped, as a concurrent lookup may still read it.
+static const uptr kMaxGlobalModules = 4096;
+extern atomic_uintptr_t cver_global_modules[kMaxGlobalModules];
+extern atomic_uintptr_t cver_num_global_module_slots;
+
+// Returns the record containing Addr in M, or 0 if there is none.
+static CVER_INLINE GlobalRecord *LookupGlobalInModule(GlobalModule *M,
+                                                      uptr Addr) {
+  if (Addr < M->Beg || Addr >= M->End)
+    return 0;
+
+  // Find the last record not above Addr.
+  uptr lo = 0, hi = M->NumRecords;
+  while (lo < hi) {
+    uptr mid = (lo + hi) / 2;
+    if (M->Records[mid].Addr <= Addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == 0)
+    return 0;
+
+  GlobalRecord *r = &M->Records[lo - 1];
+  if (Addr - r->Addr >= r->Size)
+    return 0;
+  return r;
+}
+
+// Returns the TypeTable of the global object containing Addr, and stores its
+// base address into Beg. Returns 0 if there is none.
+static CVER_INLINE uptr LookupGlobal(uptr Addr, uptr *Beg) {
+  uptr n = atomic_load(&cver_num_global_module_slots, memory_order_acquire);
+  for (uptr i = 0; i < n; i++) {
+    GlobalModule *M = (GlobalModule *)atomic_load(&cver_global_modules[i],
+                                                  memory_order_acquire);
+    if (!M)
+      continue;
+    if (GlobalRecord *r = LookupGlobalInModule(M, Addr)) {
+      *Beg = r->Addr;
+      return r->TypeTable;
+    }
+  }
+  return 0;
+}
+
+void RegisterGlobalModule(GlobalRecord *Globals, uptr NumGlobals);
+void UnregisterGlobalModule(GlobalRecord *Globals, uptr NumGlobals);
+
+} // namespace __cver
+
+#endif // CVER_GLOBAL_INDEX_H
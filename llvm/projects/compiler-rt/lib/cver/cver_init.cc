@@ -5,6 +5,7 @@
 #include "cver_flags.h"
 #include "cver_report.h"
 #include "cver_stats.h"
+#include "cver_rbtree.h"
 #include "sanitizer_common/sanitizer_suppressions.h"
 #include "sanitizer_common/sanitizer_common.h"
 
@@ -48,6 +49,8 @@ void __cver::InitCverIfNecessary() {
   cver_initialized = true;
   CverTSDInit(CverThread::TSDDtor);
   InitializeAllocator();
+  // dlsym() may allocate, so intercept after the allocator is ready.
+  InitializeCverInterceptors();
 
   // Create main thread.
   CverThread *main_thread = CverThread::Create(0, 0);
@@ -0,0 +1,56 @@
+#include "cver_internal.h"
+#include "cver_init.h"
+#include "cver_flags.h"
+#include "cver_thread.h"
+
+#include "sanitizer_common/sanitizer_common.h"
+#include "sanitizer_common/sanitizer_interception.h"
+
+using namespace __cver;
+
+extern bool cver_initialized;
+
+extern "C" {
+int pthread_attr_getdetachstate(void *attr, int *v);
+}
+
+// Every thread gets its own CverThread, so that it allocates through its own
+// allocator cache and tracks the objects on its own stack.
+static thread_return_t THREAD_CALLING_CONV cver_thread_start(void *arg) {
+  CverThread *t = (CverThread *)arg;
+  SetCurrentThread(t);
+  return t->ThreadStart(GetTid());
+}
+
+INTERCEPTOR(int, pthread_create, void *thread, void *attr,
+            void *(*start_routine)(void *), void *arg) {
+  if (!cver_initialized)
+    InitCverIfNecessary();
+
+  EnsureMainThreadIDIsCorrect();
+  int detached = 0;
+  if (attr != 0)
+    pthread_attr_getdetachstate(attr, &detached);
+
+  u32 current_tid = GetCurrentTidOrInvalid();
+  CverThread *t = CverThread::Create(start_routine, arg);
+  CreateThreadContextArgs args = { t, 0 };
+  cverThreadRegistry().CreateThread(0, detached, current_tid, &args);
+  return REAL(pthread_create)(thread, attr, cver_thread_start, t);
+}
+
+namespace __cver {
+
+void InitializeCverInterceptors() {
+  static bool was_called_once;
+  CHECK(was_called_once == false);
+  was_called_once = true;
+
+  CHECK(INTERCEPT_FUNCTION(pthread_create));
+#ifdef CVER_INTERCEPT_MALLOC
+  if (flags()->shadow_metadata)
+    InitializeCverMallocInterceptors();
+#endif
+}
+
+} // namespace __cver
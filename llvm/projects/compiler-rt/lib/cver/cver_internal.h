@@ -17,7 +17,9 @@
 # define CVER_INTERCEPT_MALLOC
 #endif
 
-#define CVER_USE_STACK_RBTREE
+// Track stack objects in a per-thread shadow stack (or a per-thread red-black
+// tree with CVER_USE_STACK_RBTREE).
+#define CVER_USE_SHADOW_STACK
 
 // #define CVER_NDEBUG
 #define CVER_MEM_ALIGNMENT 8
@@ -29,6 +31,9 @@ void CverTSDInit(void (*destructor)(void *tsd));
 void *CverTSDGet();
 void CverTSDSet(void *tsd);
 
+void InitializeCverInterceptors();
+void InitializeCverMallocInterceptors();
+
 } // namespace __cver
 
 #endif // CVER_INTERNAL_H
@@ -149,4 +149,18 @@ INTERCEPTOR(void*, malloc, uptr size) {
   return CverReallocate(0, 0, size, sizeof(u64), false);
 }
 
+namespace __cver {
+
+// The real allocator functions are used with shadow_metadata=1.
+void InitializeCverMallocInterceptors() {
+  INTERCEPT_FUNCTION(malloc);
+  INTERCEPT_FUNCTION(calloc);
+  INTERCEPT_FUNCTION(realloc);
+  INTERCEPT_FUNCTION(free);
+  INTERCEPT_FUNCTION(posix_memalign);
+  INTERCEPT_FUNCTION(malloc_usable_size);
+}
+
+} // namespace __cver
+
 #endif // CVER_INTERCEPT_MALLOC
@@ -0,0 +1,119 @@
+#include "cver_node_allocator.h"
+#include "cver_common.h"
+#include "cver_stats.h"
+#include "cver_thread.h"
+
+#include "sanitizer_common/sanitizer_mutex.h"
+
+namespace __cver {
+
+static StaticSpinMutex node_mu;
+static InternalNode *global_free_list;
+static InternalNodeCache fallback_cache;  // Guarded by node_mu.
+
+// Moves a batch of free nodes into the cache, mapping a new slab if the
+// global free list is empty. Must be called under node_mu.
+static void RefillLocked(InternalNodeCache *c) {
+  if (!global_free_list) {
+    char *slab = (char *)MmapOrDie(kInternalSlabSize, "CverInternalNodes");
+    for (uptr i = kInternalSlabSize; i >= kInternalNodeSize;
+         i -= kInternalNodeSize) {
+      InternalNode *n = (InternalNode *)(slab + i - kInternalNodeSize);
+      n->next = global_free_list;
+      global_free_list = n;
+    }
+    CVER_DEBUG_STMT(flags()->stats, {
+        GetCurrentThreadStats().internalSlabs++;
+      });
+  }
+
+  for (uptr i = 0; i < kInternalNodeBatch && global_free_list; i++) {
+    InternalNode *n = global_free_list;
+    global_free_list = n->next;
+    n->next = c->free_list;
+    c->free_list = n;
+    c->num_free++;
+  }
+}
+
+void *InternalNodeCache::Allocate() {
+  if (UNLIKELY(!free_list)) {
+    SpinMutexLock l(&node_mu);
+    RefillLocked(this);
+  }
+  InternalNode *n = free_list;
+  free_list = n->next;
+  num_free--;
+  return n;
+}
+
+void InternalNodeCache::Deallocate(void *p) {
+  InternalNode *n = (InternalNode *)p;
+  n->next = free_list;
+  free_list = n;
+  // Keep at most two batches, so that a thread freeing the nodes allocated
+  // by others does not hoard them.
+  if (UNLIKELY(++num_free > 2 * kInternalNodeBatch)) {
+    SpinMutexLock l(&node_mu);
+    for (; num_free > kInternalNodeBatch; num_free--) {
+      n = free_list;
+      free_list = n->next;
+      n->next = global_free_list;
+      global_free_list = n;
+    }
+  }
+}
+
+void InternalNodeCache::Drain() {
+  SpinMutexLock l(&node_mu);
+  while (free_list) {
+    InternalNode *n = free_list;
+    free_list = n->next;
+    n->next = global_free_list;
+    global_free_list = n;
+  }
+  num_free = 0;
+}
+
+void *AllocateInternalNode(uptr size) {
+  CHECK_LE(size, kInternalNodeSize);
+  CVER_DEBUG_STMT(flags()->stats, {
+      GetCurrentThreadStats().internalNodeAllocs++;
+    });
+
+  if (CverThread *t = GetCurrentThread())
+    return t->node_cache().Allocate();
+
+  // Not a thread of ours, or too early.
+  void *p;
+  {
+    SpinMutexLock l(&node_mu);
+    if (!fallback_cache.free_list)
+      RefillLocked(&fallback_cache);
+    InternalNode *n = fallback_cache.free_list;
+    fallback_cache.free_list = n->next;
+    fallback_cache.num_free--;
+    p = n;
+  }
+  return p;
+}
+
+void DeallocateInternalNode(void *p) {
+  if (!p)
+    return;
+  CVER_DEBUG_STMT(flags()->stats, {
+      GetCurrentThreadStats().internalNodeFrees++;
+    });
+
+  if (CverThread *t = GetCurrentThread()) {
+    t->node_cache().Deallocate(p);
+    return;
+  }
+
+  SpinMutexLock l(&node_mu);
+  InternalNode *n = (InternalNode *)p;
+  n->next = global_free_list;
+  global_free_list = n;
+}
+
+} // namespace __cver
@@ -0,0 +1,36 @@
+#ifndef CVER_NODE_ALLOCATOR_H
+#define CVER_NODE_ALLOCATOR_H
+
+#include "cver_internal.h"
+#include "sanitizer_common/sanitizer_common.h"
+
+namespace __cver {
+
+// Nodes of the runtime-internal data structures (e.g., rbtree nodes) are
+// allocated in fixed-size chunks carved out of mmap-ed slabs, apart from the
+// user heap. Every thread caches free nodes in its own free list, and moves
+// them from and to the global free list in batches.
+static const uptr kInternalNodeSize = 64;
+static const uptr kInternalNodeBatch = 64;
+static const uptr kInternalSlabSize = 1 << 16;
+
+struct InternalNode {
+  InternalNode *next;
+};
+
+struct InternalNodeCache {
+  InternalNode *free_list;
+  uptr num_free;
+
+  void *Allocate();
+  void Deallocate(void *p);
+  // Returns all the cached nodes to the global free list.
+  void Drain();
+};
+
+void *AllocateInternalNode(uptr size);
+void DeallocateInternalNode(void *p);
+
+} // namespace __cver
+
+#endif // CVER_NODE_ALLOCATOR_H
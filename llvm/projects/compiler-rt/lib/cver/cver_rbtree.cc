@@ -270,6 +270,7 @@ void __cver::rbtree_insert(rbtree t, KEY key, void* value) {
       int comp_result = compare_obj(key, n->key);
       if (comp_result == 0) {
         n->value = value;
+        rbtree_free(inserted_node);
         return;
       } else if (comp_result < 0) {
         if (n->left == NULL) {
@@ -23,9 +23,9 @@ typedef long unsigned int uptr;
 #define rbtree_free(size) free(size)
 #define rbtree_assert(cond) assert(cond)
 #else
-#include "cver_allocator.h"
-#define rbtree_malloc(size) __cver::CverReallocate(0, 0, size, sizeof(u64), false)
-#define rbtree_free(ptr) __cver::CverDeallocate(0, ptr)
+#include "cver_node_allocator.h"
+#define rbtree_malloc(size) __cver::AllocateInternalNode(size)
+#define rbtree_free(ptr) __cver::DeallocateInternalNode(ptr)
 #define rbtree_assert(cond)
 #define NULL 0
 #endif // CVER_RBTREE_STANDALONE
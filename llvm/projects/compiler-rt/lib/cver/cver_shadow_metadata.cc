@@ -0,0 +1,101 @@
+#include "cver_shadow_metadata.h"
+
+#include "sanitizer_common/sanitizer_interception.h"
+
+using namespace __cver;
+
+DECLARE_REAL(void *, malloc, uptr size)
+DECLARE_REAL(void *, calloc, uptr nmemb, uptr size)
+DECLARE_REAL(void *, realloc, void *ptr, uptr size)
+DECLARE_REAL(void, free, void *ptr)
+DECLARE_REAL(int, posix_memalign, void **memptr, uptr alignment, uptr size)
+DECLARE_REAL(uptr, malloc_usable_size, void *ptr)
+
+namespace __cver {
+
+uptr cver_shadow_metadata;
+
+// dlsym() allocates before the real allocator functions are retrieved.
+static const uptr kDlsymPoolSize = 1024;
+static uptr dlsym_pool[kDlsymPoolSize];
+static uptr dlsym_pool_allocated;
+
+static void *AllocateFromDlsymPool(uptr size) {
+  uptr size_in_words = RoundUpTo(size, 16) / sizeof(uptr);
+  void *mem = &dlsym_pool[dlsym_pool_allocated];
+  dlsym_pool_allocated += size_in_words;
+  CHECK_LT(dlsym_pool_allocated, kDlsymPoolSize);
+  return mem;
+}
+
+static bool IsInDlsymPool(void *p) {
+  return (uptr)p >= (uptr)dlsym_pool &&
+         (uptr)p < (uptr)dlsym_pool + sizeof(dlsym_pool);
+}
+
+void InitializeShadowMetadata() {
+  uptr size = (1ULL << (kShadowAddressBits - kShadowGranuleShift)) *
+              sizeof(Metadata);
+  cver_shadow_metadata = (uptr)MmapNoReserveOrDie(size, "CverShadowMetadata");
+}
+
+static void ClearShadowMetaData(void *p) {
+  Metadata *m = GetShadowMetaData((uptr)p);
+  // Avoid touching the shadow of untyped objects.
+  if (m && m->word)
+    m->word = 0;
+}
+
+void *ShadowAllocate(uptr size, uptr alignment, bool zeroise) {
+  if (UNLIKELY(!REAL(malloc) || !REAL(calloc) || !REAL(posix_memalign)))
+    return AllocateFromDlsymPool(size);
+
+  if (alignment > 16) {
+    void *p = 0;
+    if (REAL(posix_memalign)(&p, alignment, size))
+      return 0;
+    if (zeroise && p)
+      internal_memset(p, 0, size);
+    return p;
+  }
+  return zeroise ? REAL(calloc)(1, size) : REAL(malloc)(size);
+}
+
+void *ShadowReallocate(void *p, uptr size) {
+  if (UNLIKELY(IsInDlsymPool(p))) {
+    void *new_p = ShadowAllocate(size, sizeof(u64), false);
+    uptr old_size = (uptr)dlsym_pool + sizeof(dlsym_pool) - (uptr)p;
+    if (new_p)
+      internal_memcpy(new_p, p, Min(size, old_size));
+    return new_p;
+  }
+  // The object may move, and the type is dropped either way.
+  ClearShadowMetaData(p);
+  return REAL(realloc)(p, size);
+}
+
+void ShadowDeallocate(void *p) {
+  if (UNLIKELY(IsInDlsymPool(p) || !REAL(free)))
+    return;
+  ClearShadowMetaData(p);
+  REAL(free)(p);
+}
+
+uptr ShadowAllocationSize(void *p) {
+  if (UNLIKELY(IsInDlsymPool(p)) || !REAL(malloc_usable_size))
+    return 0;
+  return REAL(malloc_usable_size)(p);
+}
+
+bool SetShadowTypeTable(uptr p, void *TypeTable) {
+  if (p & ((1ULL << kShadowGranuleShift) - 1))
+    return false;
+  Metadata *m = GetShadowMetaData(p);
+  if (!m)
+    return false;
+  // Only the first element of an array is located, so the element size is
+  // never used.
+  return m->SetTyped((uptr)TypeTable, 0);
+}
+
+} // namespace __cver
@@ -0,0 +1,45 @@
+#ifndef CVER_SHADOW_METADATA_H
+#define CVER_SHADOW_METADATA_H
+
+#include "cver_allocator.h"
+#include "cver_flags.h"
+#include "cver_internal.h"
+#include "sanitizer_common/sanitizer_common.h"
+
+namespace __cver {
+
+// With shadow_metadata=1, the application keeps its own allocator, and the
+// Metadata of heap objects lives in a direct-mapped shadow instead of the
+// chunks. Every 16-byte granule has a shadow word, which keeps the Metadata of
+// the object beginning in the granule. Objects are located by their bases
+// only, so a cast is checked if it starts from the first granule of the object
+// (polymorphic objects are located by the vptr map anywhere). Objects not
+// aligned by 16 bytes are not typed.
+static const uptr kShadowGranuleShift = 4;
+static const uptr kShadowAddressBits = 47;
+
+extern uptr cver_shadow_metadata;
+
+static CVER_INLINE bool ShadowMetadataEnabled() {
+  return flags()->shadow_metadata;
+}
+
+// Returns the shadow Metadata of the granule containing p, or 0 if p is out of
+// the address space.
+static CVER_INLINE Metadata *GetShadowMetaData(uptr p) {
+  if (UNLIKELY((p >> kShadowAddressBits) || !cver_shadow_metadata))
+    return 0;
+  return &((Metadata *)cver_shadow_metadata)[p >> kShadowGranuleShift];
+}
+
+void InitializeShadowMetadata();
+
+void *ShadowAllocate(uptr size, uptr alignment, bool zeroise);
+void *ShadowReallocate(void *p, uptr size);
+void ShadowDeallocate(void *p);
+uptr ShadowAllocationSize(void *p);
+bool SetShadowTypeTable(uptr p, void *TypeTable);
+
+} // namespace __cver
+
+#endif // CVER_SHADOW_METADATA_H
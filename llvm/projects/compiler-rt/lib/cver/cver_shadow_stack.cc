@@ -0,0 +1,58 @@
+#include "cver_shadow_stack.h"
+
+SANITIZER_INTERFACE_ATTRIBUTE
+THREADLOCAL __cver::ShadowStackEntry *__cver_shadow_stack_top;
+SANITIZER_INTERFACE_ATTRIBUTE
+THREADLOCAL __cver::ShadowStackEntry *__cver_shadow_stack_end;
+
+namespace __cver {
+
+// 24MB of address space per thread, which is only committed when touched.
+static const uptr kShadowStackCapacity = 1 << 20;
+
+// Should be called from the thread itself.
+void ShadowStack::Init() {
+  uptr size = RoundUpTo(kShadowStackCapacity * sizeof(ShadowStackEntry),
+                        GetPageSizeCached());
+  Entries = (ShadowStackEntry *)MmapNoReserveOrDie(size, "CverShadowStack");
+  Sorted = 0;
+  Capacity = kShadowStackCapacity;
+  ResetTop();
+  __cver_shadow_stack_end = Entries + Capacity;
+}
+
+// Should be called from the thread itself.
+void ShadowStack::Destroy() {
+  if (!Entries)
+    return;
+  __cver_shadow_stack_top = 0;
+  __cver_shadow_stack_end = 0;
+  uptr size = RoundUpTo(Capacity * sizeof(ShadowStackEntry),
+                        GetPageSizeCached());
+  UnmapOrDie(Entries, size);
+  Entries = 0;
+  Sorted = 0;
+  Capacity = 0;
+}
+
+// The appended entries of the frames exited by longjmp() or exceptions, or
+// compiled with -fsanitize-cver-stack-no-exit, are still there, and the ones
+// below SP are dropped rather than inserted.
+void ShadowStack::SortInAppended(uptr SP) {
+  uptr Begin = Sorted + 1;
+  uptr End = __cver_shadow_stack_top - Entries;
+  Trim(SP);
+  InsertAppended(Begin, End, SP);
+  ResetTop();
+}
+
+void ShadowStack::InsertAppended(uptr Begin, uptr End, uptr SP) {
+  // Sorted stays below i, so Insert() only overwrites consumed entries.
+  for (uptr i = Begin; i < End; i++) {
+    ShadowStackEntry e = Entries[i];
+    if (e.Addr >= SP)
+      Insert(e.Addr, e.Size, e.TypeTable);
+  }
+}
+
+} // namespace __cver
@@ -0,0 +1,168 @@
+#ifndef CVER_SHADOW_STACK_H
+#define CVER_SHADOW_STACK_H
+
+#include "cver_internal.h"
+#include "sanitizer_common/sanitizer_common.h"
+#include "sanitizer_common/sanitizer_internal_defs.h"
+
+namespace __cver {
+
+// A stack object registered by __cver_handle_stack_enter(). The layout should
+// be matched with CverPruneStack::LowerStackEnter() and
+// CverPruneStack::LowerStackExit() in LLVM.
+struct ShadowStackEntry {
+  uptr Addr;
+  uptr Size;
+  uptr TypeTable;
+};
+
+} // namespace __cver
+
+extern "C" {
+// The next free entry and the end of the shadow stack of the current thread.
+// Code compiled with -fsanitize-cver-stack-inline appends and pops entries
+// through them without calling the runtime, as long as the top does not reach
+// the end.
+extern SANITIZER_INTERFACE_ATTRIBUTE
+THREADLOCAL __cver::ShadowStackEntry *__cver_shadow_stack_top;
+extern SANITIZER_INTERFACE_ATTRIBUTE
+THREADLOCAL __cver::ShadowStackEntry *__cver_shadow_stack_end;
+} // extern "C"
+
+namespace __cver {
+
+// Stack objects are created and destroyed in LIFO order, and the objects of
+// deeper frames are placed at lower addresses. The shadow stack keeps the
+// entries sorted by descending address, so pushes and pops mostly touch the
+// top entry only, and lookups are binary searches. The entries live in a
+// region reserved per thread, which is committed on demand.
+//
+// Entries are not necessarily popped: frames may exit by longjmp() or by
+// exceptions, or be compiled with -fsanitize-cver-stack-no-exit. Such dead
+// entries are discarded lazily, either when they are below the current stack
+// pointer (the watermark), or when a new object overlaps them.
+//
+// This is not exact: a later frame reuses the addresses of the exited ones
+// while the stack pointer is below them, and its objects that are not
+// registered, like the ones of uninstrumented code, do not overlap the dead
+// entries away. A pointer to such an object is then checked against the type
+// of a dead entry. Only the exits of the frames make the entries exact.
+//
+// Code compiled with -fsanitize-cver-stack-inline appends the entries past a
+// blank entry after the sorted ones, and pops an entry by restoring the top
+// saved when it was appended, as long as the entry is still the last one.
+// The blank entry keeps such pops off the sorted entries. Every operation of
+// the runtime sorts in the appended entries first.
+struct ShadowStack {
+  ShadowStackEntry *Entries;
+  uptr Sorted;
+  uptr Capacity;
+
+  void Init();
+  void Destroy();
+
+  // Sorts in the entries appended inline. SP is the current stack pointer, or
+  // 0 if it is unknown.
+  CVER_INLINE void Normalize(uptr SP) {
+    if (UNLIKELY(__cver_shadow_stack_top != Entries + Sorted + 1))
+      SortInAppended(SP);
+  }
+
+  // Places the top past the blank entry after the sorted entries. A stale
+  // address in the blank entry would let an inline pop take it for its own.
+  CVER_INLINE void ResetTop() {
+    Entries[Sorted].Addr = 0;
+    __cver_shadow_stack_top = Entries + Sorted + 1;
+  }
+
+  // Discards the entries below SP, which belong to the exited frames.
+  CVER_INLINE void Trim(uptr SP) {
+    while (Sorted > 0 && Entries[Sorted - 1].Addr < SP)
+      Sorted--;
+    ResetTop();
+  }
+
+  // Returns false if the shadow stack is full. SP is the current stack
+  // pointer, which must be below the frame of the new object.
+  CVER_INLINE bool Push(uptr Addr, uptr Size, uptr TypeTable, uptr SP) {
+    Normalize(SP);
+    Trim(SP);
+    bool res = Insert(Addr, Size, TypeTable);
+    ResetTop();
+    return res;
+  }
+
+  // Returns false if Addr is not registered.
+  CVER_INLINE bool Pop(uptr Addr, uptr SP) {
+    Normalize(SP);
+    uptr i = Sorted;
+    for (; i > 0 && Entries[i - 1].Addr != Addr; i--) {}
+    if (UNLIKELY(i == 0))
+      return false;
+
+    for (; i < Sorted; i++)
+      Entries[i - 1] = Entries[i];
+    Sorted--;
+    ResetTop();
+    return true;
+  }
+
+  // Returns the entry containing Addr, or 0 if there is none.
+  CVER_INLINE ShadowStackEntry *Lookup(uptr Addr, uptr SP) {
+    Normalize(SP);
+    Trim(SP);
+
+    // Find the first entry not above Addr.
+    uptr lo = 0, hi = Sorted;
+    while (lo < hi) {
+      uptr mid = (lo + hi) / 2;
+      if (Entries[mid].Addr > Addr)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if (lo == Sorted)
+      return 0;
+
+    ShadowStackEntry *e = &Entries[lo];
+    if (Addr - e->Addr >= e->Size)
+      return 0;
+    return e;
+  }
+
+ private:
+  void SortInAppended(uptr SP);
+  void InsertAppended(uptr Begin, uptr End, uptr SP);
+
+  // Inserts an entry into the sorted entries. It may overwrite the entry at
+  // Sorted, which is the blank one or has been consumed by Normalize()
+  // already.
+  CVER_INLINE bool Insert(uptr Addr, uptr Size, uptr TypeTable) {
+    // The entries from k are placed below the end of the new object. Locals
+    // of the same frame may be pushed out of the address order, and the
+    // entries overlapping with the new object are dead.
+    uptr k = Sorted;
+    for (; k > 0 && Entries[k - 1].Addr < Addr + Size; k--) {}
+    uptr n = k;
+    for (uptr i = k; i < Sorted; i++) {
+      if (Entries[i].Addr + Entries[i].Size <= Addr)
+        Entries[n++] = Entries[i];
+    }
+    Sorted = n;
+    // Leave room for the blank entry.
+    if (UNLIKELY(Sorted + 1 == Capacity))
+      return false;
+
+    for (uptr i = Sorted; i > k; i--)
+      Entries[i] = Entries[i - 1];
+    Entries[k].Addr = Addr;
+    Entries[k].Size = Size;
+    Entries[k].TypeTable = TypeTable;
+    Sorted++;
+    return true;
+  }
+};
+
+} // namespace __cver
+
+#endif // CVER_SHADOW_STACK_H
@@ -3,6 +3,7 @@
 #include "cver_stats.h"
 #include "cver_thread.h"
 #include "cver_allocator.h"
+#include "cver_node_allocator.h"
 
 #include "sanitizer_common/sanitizer_common.h"
 #include "sanitizer_common/sanitizer_mutex.h"
@@ -23,6 +24,12 @@ void CverStats::Print() {
   Printf("Stats: %zuM freed by %zu calls\n", freed>>20, frees);
   Printf("Stats: %zuM (%zuM-%zuM) mmaped; %zu maps, %zu unmaps\n",
          (mmaped-munmaped)>>20, mmaped>>20, munmaped>>20, mmaps, munmaps);
+  Printf("Stats: %zuM released to the OS by %zu calls\n",
+         released>>20, releases);
+  Printf("Stats: %zuK in per-thread allocator caches; %zu grows, %zu trims\n",
+         allocatorCacheBytes>>10, allocatorCacheGrows, allocatorCacheTrims);
+  Printf("Stats: %zuK in the largest per-thread allocator cache\n",
+         allocatorCachePeak>>10);
   Printf("\n");
   
   Printf("Stats: %zu stackObjAlloc\n", stackObjAlloc);
@@ -49,18 +56,27 @@ void CverStats::Print() {
   Printf("Stats: %zu stackCasts\n", stackCasts);
   Printf("Stats: %zu dynCasts\n", dynCasts);
   Printf("Stats: %zu globalCasts\n", globalCasts);
+  Printf("Stats: %zu vptrCasts\n", vptrCasts);
   Printf("Stats: %zu unknownCasts\n", unknownCasts);  
   Printf("Stats: %zu casts\n", casts);
   Printf("Stats: %zu cache hit / %zu cache miss\n",
-         cache_hits, casts-cache_hits);
+         cache_hits, cache_misses);
+  Printf("Stats: %zu cast bitmap hit\n", bitmap_hits);
+  Printf("\n");
+
+  Printf("Stats: %zu internal nodes allocated, %zu freed, in %zuK slabs\n",
+         internalNodeAllocs, internalNodeFrees,
+         (internalSlabs * kInternalSlabSize) >> 10);
 }
 
 void CverStats::MergeFrom(const CverStats *stats) {
+  uptr peak = Max(allocatorCachePeak, stats->allocatorCachePeak);
   uptr *dst_ptr = reinterpret_cast<uptr*>(this);
   const uptr *src_ptr = reinterpret_cast<const uptr*>(stats);
   uptr num_fields = sizeof(*this) / sizeof(uptr);
   for (uptr i = 0; i < num_fields; i++)
     dst_ptr[i] += src_ptr[i];
+  allocatorCachePeak = peak;
 }
 
 static BlockingMutex print_lock(LINKER_INITIALIZED);
@@ -34,13 +34,30 @@ struct CverStats {
   uptr stackCasts;
   uptr globalCasts;
   uptr dynCasts;
+  uptr vptrCasts;
   
   uptr cache_hits;
+  uptr cache_misses;
+  uptr bitmap_hits;
   
   uptr mmaps;
   uptr mmaped;
   uptr munmaps;
   uptr munmaped;
+  uptr releases;
+  uptr released;
+  // Bytes of the per-thread allocator caches, and how often they grew and
+  // shrank. The peak is the most a single cache has taken, and is merged as
+  // the maximum rather than the sum.
+  uptr allocatorCacheBytes;
+  uptr allocatorCachePeak;
+  uptr allocatorCacheGrows;
+  uptr allocatorCacheTrims;
+
+  // Runtime-internal nodes, not counted in the user heap stats above.
+  uptr internalNodeAllocs;
+  uptr internalNodeFrees;
+  uptr internalSlabs;
   
   // Ctor for global CverStats (accumulated stats for dead threads).
   explicit CverStats(LinkerInitialized) { }
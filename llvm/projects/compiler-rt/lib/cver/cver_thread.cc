@@ -81,6 +81,10 @@ void CverThread::Destroy() {
   VReport(1, "T%d exited\n", tid);
 
   malloc_storage().CommitBack();
+  node_cache().Drain();
+#ifdef CVER_USE_SHADOW_STACK
+  shadow_stack.Destroy();
+#endif
   if (common_flags()->use_sigaltstack) UnsetAlternateSignalStack();
   cverThreadRegistry().FinishThread(tid);
   FlushToDeadThreadStats(&stats_);
@@ -97,8 +101,14 @@ void CverThread::Init() {
   SetThreadStackAndTls();
   CHECK_GT(this->stack_size(), 0U);
 
+#ifdef CVER_USE_STACK_RBTREE
   rbtree_root = rbtree_create();
-  
+#endif
+
+#ifdef CVER_USE_SHADOW_STACK
+  shadow_stack.Init();
+#endif
+
   int local = 0;
   VReport(1, "T%d: stack [%p,%p) size 0x%zx; local=%p\n", tid(),
           (void *)stack_bottom_, (void *)stack_top_, stack_top_ - stack_bottom_,
@@ -2,7 +2,9 @@
 #define CVER_THREAD_H
 
 #include "cver_allocator.h"
+#include "cver_cache.h"
 #include "cver_internal.h"
+#include "cver_node_allocator.h"
 #include "cver_stats.h"
 #include "sanitizer_common/sanitizer_common.h"
 #include "sanitizer_common/sanitizer_libc.h"
@@ -12,6 +14,10 @@
 #include "cver_rbtree.h"
 #endif
 
+#ifdef CVER_USE_SHADOW_STACK
+#include "cver_shadow_stack.h"
+#endif
+
 namespace __cver {
 
 const u32 kInvalidTid = 0xffffff;  // Must fit into 24 bits.
@@ -86,6 +92,8 @@ class CverThread {
 
   CverThreadLocalMallocStorage &malloc_storage() { return malloc_storage_; }
   CverStats &stats() { return stats_; }
+  CverCastCache &cast_cache() { return cast_cache_; }
+  InternalNodeCache &node_cache() { return node_cache_; }
 
 #ifdef CVER_USE_STACK_MAP  
   StackMapBucket StackMap[STACK_MAP_SIZE];  
@@ -96,6 +104,10 @@ class CverThread {
   rbtree rbtree_root;
 #endif
 
+#ifdef CVER_USE_SHADOW_STACK
+  ShadowStack shadow_stack;
+#endif
+
  private:
   // NOTE: There is no CverThread constructor. It is allocated
   // via mmap() and *must* be valid in zero-initialized state.
@@ -114,6 +126,8 @@ class CverThread {
 
   CverThreadLocalMallocStorage malloc_storage_;
   CverStats stats_;
+  CverCastCache cast_cache_;
+  InternalNodeCache node_cache_;
   bool unwinding_;
 };
 
@@ -145,6 +159,15 @@ rbtree GetCurrentThreadRbtreeRoot();
 rbtree GetCurrentThreadRbtreeRootWithThread(CverThread *thread);
 #endif // CVER_USE_STACK_RBTREE
 
+#ifdef CVER_USE_SHADOW_STACK
+// Returns the current stack pointer as the watermark of the shadow stack, or 0
+// if it is not in the thread stack (e.g., on an alternate signal stack).
+static CVER_INLINE uptr GetShadowStackWatermark(CverThread *t) {
+  uptr sp = (uptr)__builtin_frame_address(0);
+  return t->AddrIsInStack(sp) ? sp : 0;
+}
+#endif // CVER_USE_SHADOW_STACK
+
 }  // namespace __cver
 
 #endif  // CVER_THREAD_H
@@ -0,0 +1,108 @@
+#include "cver_vptr_map.h"
+#include "cver_cache.h"
+
+#include "sanitizer_common/sanitizer_libc.h"
+#include "sanitizer_common/sanitizer_mutex.h"
+
+namespace __cver {
+
+atomic_uintptr_t cver_vptr_map;
+
+static StaticSpinMutex vptr_map_mu;
+// The used slots, including the tombstones.
+static uptr num_vptrs;
+
+static const uptr kInitialVptrMapSize = 4096;
+
+static VptrMapEntry *FindVptr(VptrMap *map, uptr Vptr) {
+  for (uptr i = GetVptrMapIndex(Vptr) & map->mask;;
+       i = (i + 1) & map->mask) {
+    VptrMapEntry *e = &map->Entries[i];
+    uptr v = atomic_load(&e->Vptr, memory_order_relaxed);
+    if (v == Vptr)
+      return e;
+    if (!v)
+      return 0;
+  }
+}
+
+static void InsertVptr(VptrMap *map, uptr Vptr, uptr TypeTable,
+                       uptr BaseOffset, uptr RefCount) {
+  for (uptr i = GetVptrMapIndex(Vptr) & map->mask;;
+       i = (i + 1) & map->mask) {
+    VptrMapEntry *e = &map->Entries[i];
+    uptr v = atomic_load(&e->Vptr, memory_order_relaxed);
+    if (!v) {
+      e->TypeTable = TypeTable;
+      e->BaseOffset = BaseOffset;
+      e->RefCount = RefCount;
+      atomic_store(&e->Vptr, Vptr, memory_order_release);
+      num_vptrs++;
+      return;
+    }
+  }
+}
+
+// Keep the load factor under 0.5, so there always exists an empty slot.
+static VptrMap *GrowVptrMap(VptrMap *old) {
+  uptr size = old ? (old->mask + 1) * 2 : kInitialVptrMapSize;
+  VptrMap *map = (VptrMap *)MmapOrDie(
+    sizeof(uptr) + size * sizeof(VptrMapEntry), "CverVptrMap");
+  map->mask = size - 1;
+
+  num_vptrs = 0;
+  if (old) {
+    for (uptr i = 0; i <= old->mask; i++) {
+      VptrMapEntry *e = &old->Entries[i];
+      uptr v = atomic_load(&e->Vptr, memory_order_relaxed);
+      if (v && v != kVptrTombstone)
+        InsertVptr(map, v, e->TypeTable, e->BaseOffset, e->RefCount);
+    }
+  }
+  atomic_store(&cver_vptr_map, (uptr)map, memory_order_release);
+  return map;
+}
+
+// The casts verified inline may have been cached by the vptr of the removed
+// entry, which a module loaded later can reuse for another vtable.
+static void RemoveVptr(VptrMapEntry *e) {
+  atomic_store(&e->Vptr, kVptrTombstone, memory_order_release);
+  internal_memset(__cver_vptr_type_cache, 0, sizeof(__cver_vptr_type_cache));
+}
+
+void RegisterVptr(uptr Vptr, uptr TypeTable, uptr BaseOffset) {
+  if (!Vptr)
+    return;
+
+  SpinMutexLock l(&vptr_map_mu);
+  VptrMap *map = (VptrMap *)atomic_load(&cver_vptr_map, memory_order_relaxed);
+  // The same vtable is registered again by every module sharing it. A
+  // different registration of the vtable, e.g., by a module loaded at the
+  // address of an unloaded one which did not unregister it, wins.
+  VptrMapEntry *e = map ? FindVptr(map, Vptr) : 0;
+  if (e) {
+    if (e->TypeTable == TypeTable && e->BaseOffset == BaseOffset) {
+      e->RefCount++;
+      return;
+    }
+    RemoveVptr(e);
+  }
+  if (!map || (num_vptrs + 1) * 2 > map->mask + 1)
+    map = GrowVptrMap(map);
+  InsertVptr(map, Vptr, TypeTable, BaseOffset, 1);
+}
+
+// Invoked when a module registered Vptr is unloaded. The entry is only
+// removed when the last module registered it with TypeTable is unloaded.
+void UnregisterVptr(uptr Vptr, uptr TypeTable) {
+  if (!Vptr)
+    return;
+
+  SpinMutexLock l(&vptr_map_mu);
+  VptrMap *map = (VptrMap *)atomic_load(&cver_vptr_map, memory_order_relaxed);
+  VptrMapEntry *e = map ? FindVptr(map, Vptr) : 0;
+  if (e && e->TypeTable == TypeTable && --e->RefCount == 0)
+    RemoveVptr(e);
+}
+
+} // namespace __cver
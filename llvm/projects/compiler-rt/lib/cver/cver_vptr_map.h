@@ -0,0 +1,60 @@
+#ifndef CVER_VPTR_MAP_H
+#define CVER_VPTR_MAP_H
+
+#include "cver_internal.h"
+#include "sanitizer_common/sanitizer_atomic.h"
+#include "sanitizer_common/sanitizer_common.h"
+
+namespace __cver {
+
+// A vtable address point registered by __cver_register_vtables(). An object
+// with the vptr Vptr is a base subobject at BaseOffset of an object of
+// TypeTable. A vtable and its THTable may be emitted in several modules, and
+// resolve to the same copy across them, so RefCount counts the modules that
+// registered the pair. RefCount is only accessed under the map lock.
+struct VptrMapEntry {
+  atomic_uintptr_t Vptr;
+  uptr TypeTable;
+  uptr BaseOffset;
+  uptr RefCount;
+};
+
+// An open-addressed (linear probing) map from vptrs to VptrMapEntry. It only
+// grows, and the old tables are never unmapped so that lookups never take a
+// lock. An entry is never rewritten once published: an unregistered entry
+// becomes a tombstone, which is only dropped when the map grows.
+static const uptr kVptrTombstone = 1;
+
+struct VptrMap {
+  uptr mask;
+  VptrMapEntry Entries[1];
+};
+
+extern atomic_uintptr_t cver_vptr_map;
+
+static CVER_INLINE uptr GetVptrMapIndex(uptr Vptr) {
+  return (Vptr * 0x9E3779B97F4A7C15ULL) >> 32;
+}
+
+// Returns the entry registered for Vptr, or 0 if it is not registered.
+static CVER_INLINE VptrMapEntry *LookupVptr(uptr Vptr) {
+  VptrMap *map = (VptrMap *)atomic_load(&cver_vptr_map, memory_order_acquire);
+  if (!map || !Vptr)
+    return 0;
+
+  for (uptr i = GetVptrMapIndex(Vptr) & map->mask;;
+       i = (i + 1) & map->mask) {
+    uptr v = atomic_load(&map->Entries[i].Vptr, memory_order_acquire);
+    if (v == Vptr)
+      return &map->Entries[i];
+    if (!v)
+      return 0;
+  }
+}
+
+void RegisterVptr(uptr Vptr, uptr TypeTable, uptr BaseOffset);
+void UnregisterVptr(uptr Vptr, uptr TypeTable);
+
+} // namespace __cver
+
+#endif // CVER_VPTR_MAP_H
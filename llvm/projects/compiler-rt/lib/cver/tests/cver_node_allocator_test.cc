@@ -0,0 +1,168 @@
+#include "cver_node_allocator.h"
+#include "gtest/gtest.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace __cver {
+
+static const uptr kNodesPerSlab = kInternalSlabSize / kInternalNodeSize;
+
+// Fills the whole node, so that overlapping nodes corrupt each other.
+static void FillNode(void *p, uptr i) {
+  memset(p, (int)(i & 0xff), kInternalNodeSize);
+}
+
+static void CheckNode(void *p, uptr i) {
+  unsigned char *b = (unsigned char *)p;
+  for (uptr j = 0; j < kInternalNodeSize; j++)
+    ASSERT_EQ((unsigned char)(i & 0xff), b[j]);
+}
+
+static void CheckDisjointNodes(std::vector<void *> nodes) {
+  std::sort(nodes.begin(), nodes.end());
+  for (uptr i = 0; i < nodes.size(); i++) {
+    ASSERT_EQ(0U, (uptr)nodes[i] % kInternalNodeSize);
+    if (i > 0)
+      ASSERT_LE((uptr)nodes[i - 1] + kInternalNodeSize, (uptr)nodes[i]);
+  }
+}
+
+TEST(CverNodeAllocator, Refill) {
+  InternalNodeCache c = {};
+  std::vector<void *> nodes;
+  // More than the global free list may hold, so that new slabs are mapped.
+  for (uptr i = 0; i < 4 * kNodesPerSlab; i++) {
+    void *p = c.Allocate();
+    ASSERT_NE((void *)0, p);
+    // The cache refills a batch at a time.
+    ASSERT_LT(c.num_free, kInternalNodeBatch);
+    FillNode(p, i);
+    nodes.push_back(p);
+  }
+  for (uptr i = 0; i < nodes.size(); i++)
+    CheckNode(nodes[i], i);
+  CheckDisjointNodes(nodes);
+
+  for (uptr i = 0; i < nodes.size(); i++) {
+    c.Deallocate(nodes[i]);
+    // The cache keeps at most two batches.
+    ASSERT_LE(c.num_free, 2 * kInternalNodeBatch);
+  }
+  c.Drain();
+  EXPECT_EQ(0U, c.num_free);
+  EXPECT_EQ((InternalNode *)0, c.free_list);
+}
+
+TEST(CverNodeAllocator, Reuse) {
+  InternalNodeCache c = {};
+  void *p = c.Allocate();
+  FillNode(p, 1);
+  c.Deallocate(p);
+  // The last freed node is reused first.
+  void *q = c.Allocate();
+  EXPECT_EQ(p, q);
+  // The whole node is usable again, not only the free list link.
+  FillNode(q, 2);
+  CheckNode(q, 2);
+  c.Deallocate(q);
+  c.Drain();
+}
+
+struct AllocatorThreadArgs {
+  InternalNodeCache *cache;
+  std::vector<void *> *nodes;
+  uptr count;
+};
+
+static void *AllocatorThread(void *arg) {
+  AllocatorThreadArgs *args = (AllocatorThreadArgs *)arg;
+  for (uptr i = 0; i < args->count; i++) {
+    void *p = args->cache->Allocate();
+    FillNode(p, i);
+    args->nodes->push_back(p);
+  }
+  return 0;
+}
+
+TEST(CverNodeAllocator, CrossThreadFree) {
+  InternalNodeCache allocating = {};
+  InternalNodeCache freeing = {};
+  InternalNodeCache reusing = {};
+  std::vector<void *> nodes;
+  AllocatorThreadArgs args = { &allocating, &nodes, 3 * kInternalNodeBatch };
+  pthread_t t;
+  ASSERT_EQ(0, pthread_create(&t, 0, AllocatorThread, &args));
+  ASSERT_EQ(0, pthread_join(t, 0));
+  ASSERT_EQ(args.count, nodes.size());
+  for (uptr i = 0; i < nodes.size(); i++)
+    CheckNode(nodes[i], i);
+
+  // The freeing thread hands the nodes beyond two batches back to the global
+  // free list, rather than hoarding the nodes of the allocating thread.
+  for (uptr i = 0; i < nodes.size(); i++) {
+    freeing.Deallocate(nodes[i]);
+    ASSERT_LE(freeing.num_free, 2 * kInternalNodeBatch);
+  }
+  EXPECT_LT(freeing.num_free, nodes.size());
+  std::vector<void *> reused;
+  reused.reserve(nodes.size());
+  freeing.Drain();
+
+  // The global free list is LIFO, so the next refills get the same nodes.
+  for (uptr i = 0; i < nodes.size(); i++) {
+    void *p = reusing.Allocate();
+    FillNode(p, i);
+    reused.push_back(p);
+  }
+  std::sort(nodes.begin(), nodes.end());
+  std::sort(reused.begin(), reused.end());
+  EXPECT_TRUE(nodes == reused);
+
+  for (uptr i = 0; i < reused.size(); i++)
+    reusing.Deallocate(reused[i]);
+  reusing.Drain();
+  allocating.Drain();
+}
+
+static void *AllocateAndFreeNodes(void *arg) {
+  std::vector<void *> *nodes = (std::vector<void *> *)arg;
+  for (uptr i = 0; i < nodes->size(); i++) {
+    DeallocateInternalNode((*nodes)[i]);
+    (*nodes)[i] = AllocateInternalNode(kInternalNodeSize);
+    FillNode((*nodes)[i], i);
+  }
+  return 0;
+}
+
+TEST(CverNodeAllocator, ConcurrentThreads) {
+  static const int kNumThreads = 4;
+  std::vector<void *> nodes[kNumThreads];
+  for (int i = 0; i < kNumThreads; i++)
+    for (uptr j = 0; j < 4 * kInternalNodeBatch; j++)
+      nodes[i].push_back(AllocateInternalNode(kInternalNodeSize));
+
+  // Each thread frees the nodes allocated by the main thread, and allocates
+  // its own.
+  pthread_t threads[kNumThreads];
+  for (int i = 0; i < kNumThreads; i++)
+    ASSERT_EQ(0, pthread_create(&threads[i], 0, AllocateAndFreeNodes,
+                                &nodes[i]));
+  for (int i = 0; i < kNumThreads; i++)
+    ASSERT_EQ(0, pthread_join(threads[i], 0));
+
+  std::vector<void *> all;
+  for (int i = 0; i < kNumThreads; i++) {
+    for (uptr j = 0; j < nodes[i].size(); j++)
+      CheckNode(nodes[i][j], j);
+    all.insert(all.end(), nodes[i].begin(), nodes[i].end());
+  }
+  CheckDisjointNodes(all);
+  for (uptr i = 0; i < all.size(); i++)
+    DeallocateInternalNode(all[i]);
+}
+
+}  // namespace __cver
@@ -323,6 +323,9 @@ class SizeClassAllocator64 {
     CHECK_EQ(kSpaceBeg,
              reinterpret_cast<uptr>(Mprotect(kSpaceBeg, kSpaceSize)));
     MapWithCallback(kSpaceEnd, AdditionalSize());
+    for (uptr class_id = 1; class_id < kNumClasses; class_id++)
+      GetRegionInfo(class_id)->size_reciprocal =
+          ComputeReciprocal(SizeClassMap::Size(class_id));
   }
 
   void MapWithCallback(uptr beg, uptr size) {
@@ -340,7 +343,10 @@ class SizeClassAllocator64 {
       alignment <= SizeClassMap::kMaxSize;
   }
 
-  NOINLINE Batch* AllocateBatch(AllocatorStats *stat, AllocatorCache *c,
+  // Cache may be any local cache type that can allocate transfer batches,
+  // not only AllocatorCache.
+  template <class Cache>
+  NOINLINE Batch* AllocateBatch(AllocatorStats *stat, Cache *c,
                                 uptr class_id) {
     CHECK_LT(class_id, kNumClasses);
     RegionInfo *region = GetRegionInfo(class_id);
@@ -371,12 +377,12 @@ class SizeClassAllocator64 {
     uptr class_id = GetSizeClass(p);
     uptr size = SizeClassMap::Size(class_id);
     if (!size) return 0;
-    uptr chunk_idx = GetChunkIdx((uptr)p, size);
+    if (class_id >= kNumClasses) return 0;
+    RegionInfo *region = GetRegionInfo(class_id);
+    uptr chunk_idx = GetChunkIdx((uptr)p, region->size_reciprocal);
     uptr reg_beg = (uptr)p & ~(kRegionSize - 1);
     uptr beg = chunk_idx * size;
     uptr next_beg = beg + size;
-    if (class_id >= kNumClasses) return 0;
-    RegionInfo *region = GetRegionInfo(class_id);
     if (region->mapped_user >= next_beg) {
       // compute and store metadata.
       *ppMetaData =
@@ -393,12 +399,12 @@ class SizeClassAllocator64 {
     uptr class_id = GetSizeClass(p);
     uptr size = SizeClassMap::Size(class_id);
     if (!size) return 0;
-    uptr chunk_idx = GetChunkIdx((uptr)p, size);
+    if (class_id >= kNumClasses) return 0;
+    RegionInfo *region = GetRegionInfo(class_id);
+    uptr chunk_idx = GetChunkIdx((uptr)p, region->size_reciprocal);
     uptr reg_beg = (uptr)p & ~(kRegionSize - 1);
     uptr beg = chunk_idx * size;
     uptr next_beg = beg + size;
-    if (class_id >= kNumClasses) return 0;
-    RegionInfo *region = GetRegionInfo(class_id);
     if (region->mapped_user >= next_beg)
       return reinterpret_cast<void*>(reg_beg + beg);
     return 0;
@@ -413,8 +419,8 @@ class SizeClassAllocator64 {
 
   void *GetMetaData(const void *p) {
     uptr class_id = GetSizeClass(p);
-    uptr size = SizeClassMap::Size(class_id);
-    uptr chunk_idx = GetChunkIdx(reinterpret_cast<uptr>(p), size);
+    uptr chunk_idx = GetChunkIdx(reinterpret_cast<uptr>(p),
+                                 GetRegionInfo(class_id)->size_reciprocal);
     return reinterpret_cast<void*>(kSpaceBeg + (kRegionSize * (class_id + 1)) -
                                    (1 + chunk_idx) * kMetadataSize);
   }
@@ -486,11 +492,73 @@ class SizeClassAllocator64 {
     }
   }
 
+  // Returns the pages of the chunks in the central free list of class_id to
+  // the OS, and returns the number of bytes released. The chunks cached by
+  // threads are not released. The pages holding the free list itself (i.e.,
+  // the batches stored in the free chunks) are kept.
+  uptr ReleaseFreeMemoryToOS(uptr class_id) {
+    RegionInfo *region = GetRegionInfo(class_id);
+    uptr size = SizeClassMap::Size(class_id);
+    uptr page_size = GetPageSizeCached();
+    if (!size)
+      return 0;
+
+    // Taking the region mutex stops refilling from the region, while
+    // AllocateBatch() finds the free list empty for a while.
+    BlockingMutexLock l(&region->mutex);
+    Batch *batches = 0;
+    InternalMmapVector<uptr> chunks(1024);
+    InternalMmapVector<uptr> headers(64);
+    while (Batch *b = region->free_list.Pop()) {
+      headers.push_back(reinterpret_cast<uptr>(b));
+      for (uptr i = 0; i < b->count; i++)
+        chunks.push_back(reinterpret_cast<uptr>(b->batch[i]));
+      b->next = batches;
+      batches = b;
+    }
+
+    uptr released = 0;
+    if (chunks.size()) {
+      InternalSort(&chunks, chunks.size(), AddressLess);
+      InternalSort(&headers, headers.size(), AddressLess);
+      uptr run_beg = 0, run_end = 0, h = 0;
+      for (uptr i = 0; i <= chunks.size(); i++) {
+        uptr chunk = i < chunks.size() ? chunks[i] : 0;
+        for (; h < headers.size() && headers[h] < chunk; h++) {}
+        // A chunk holding a batch ends the run.
+        bool holds_header = chunk && h < headers.size() &&
+                            headers[h] < chunk + size;
+        if (chunk && !holds_header && chunk == run_end) {
+          run_end += size;
+          continue;
+        }
+        uptr beg = RoundUpTo(run_beg, page_size);
+        uptr end = RoundDownTo(run_end, page_size);
+        if (beg < end) {
+          FlushUnneededShadowMemory(beg, end - beg);
+          released += end - beg;
+        }
+        run_beg = run_end = holds_header ? 0 : chunk;
+        if (!holds_header && chunk)
+          run_end += size;
+      }
+    }
+
+    while (batches) {
+      Batch *b = batches;
+      batches = b->next;
+      region->free_list.Push(b);
+    }
+    return released;
+  }
+
   typedef SizeClassMap SizeClassMapT;
   static const uptr kNumClasses = SizeClassMap::kNumClasses;
   static const uptr kNumClassesRounded = SizeClassMap::kNumClassesRounded;
 
  private:
+  static bool AddressLess(const uptr &a, const uptr &b) { return a < b; }
+
   static const uptr kRegionSize = kSpaceSize / kNumClassesRounded;
   static const uptr kSpaceEnd = kSpaceBeg + kSpaceSize;
   COMPILER_CHECK(kSpaceBeg % kSpaceSize == 0);
@@ -510,6 +578,8 @@ class SizeClassAllocator64 {
     uptr allocated_user;  // Bytes allocated for user memory.
     uptr allocated_meta;  // Bytes allocated for metadata.
     uptr mapped_user;  // Bytes mapped for user memory.
+    // See ComputeReciprocal(). Read along with mapped_user.
+    u64 size_reciprocal;
     uptr mapped_meta;  // Bytes mapped for metadata.
     uptr n_allocated, n_freed;  // Just stats.
   };
@@ -526,16 +596,32 @@ class SizeClassAllocator64 {
     return &regions[class_id];
   }
 
-  _ALWAYS_INLINE static uptr GetChunkIdx(uptr chunk, uptr size) {
+  // Chunk indices are computed without a division, as the high half of the
+  // product of the offset and ceil(2^64 / size). With e = reciprocal * size -
+  // 2^64 < size, the product is offset / size + offset * e / (size * 2^64),
+  // so the quotient is exact if offset * e < 2^64. Chunks larger than a
+  // region do not matter.
+  static const uptr kMaxChunkSize = SizeClassMap::kMaxSize < kRegionSize ?
+      SizeClassMap::kMaxSize : kRegionSize;
+  COMPILER_CHECK(kRegionSize - 1 <= ~(u64)0 / kMaxChunkSize);
+
+  static u64 ComputeReciprocal(uptr size) {
+    CHECK_GT(size, 1);
+    return ~(u64)0 / size + 1;
+  }
+
+  _ALWAYS_INLINE static uptr GetChunkIdx(uptr chunk, u64 size_reciprocal) {
     uptr offset = chunk % kRegionSize;
-    // Here we divide by a non-constant. This is costly.
-    // size always fits into 32-bits. If the offset fits too, use 32-bit div.
-    if (offset >> (SANITIZER_WORDSIZE / 2))
-      return offset / size;
-    return (u32)offset / (u32)size;
+#if SANITIZER_WORDSIZE == 64
+    return (uptr)(((unsigned __int128)offset * size_reciprocal) >> 64);
+#else
+    // SizeClassAllocator64 is used on 64-bit targets only.
+    return 0;
+#endif
   }
 
-  NOINLINE Batch* PopulateFreeList(AllocatorStats *stat, AllocatorCache *c,
+  template <class Cache>
+  NOINLINE Batch* PopulateFreeList(AllocatorStats *stat, Cache *c,
                                    uptr class_id, RegionInfo *region) {
     BlockingMutexLock l(&region->mutex);
     Batch *b = region->free_list.Pop();
@@ -233,6 +233,133 @@ TEST(SanitizerCommon, SizeClassAllocator32CompactGetBlockBegin) {
 }
 #endif  // SANITIZER_WORDSIZE == 64
 
+#if SANITIZER_WORDSIZE == 64
+TEST(SanitizerCommon, SizeClassAllocator64ReleaseFreeMemoryToOS) {
+  Allocator64 *a = new Allocator64;
+  a->Init();
+  SizeClassAllocatorLocalCache<Allocator64> cache;
+  memset(&cache, 0, sizeof(cache));
+  cache.Init(0);
+
+  // A small class (in-region batches) and a large one.
+  uptr classes[] = {1, Allocator64::kNumClasses - 10};
+  for (uptr c = 0; c < ARRAY_SIZE(classes); c++) {
+    uptr class_id = classes[c];
+    uptr size = Allocator64::SizeClassMapT::Size(class_id);
+    uptr n = Min((uptr)10000, (64UL << 20) / size);
+    std::vector<void *> allocated;
+    for (uptr i = 0; i < n; i++) {
+      void *x = cache.Allocate(a, class_id);
+      memset(x, 0xab, size);
+      allocated.push_back(x);
+    }
+    for (uptr i = 0; i < n; i++)
+      cache.Deallocate(a, class_id, allocated[i]);
+    cache.Drain(a);
+    EXPECT_GT(a->ReleaseFreeMemoryToOS(class_id), 0U);
+
+    // The free list survives the release.
+    std::set<void *> reallocated;
+    for (uptr i = 0; i < n; i++) {
+      void *x = cache.Allocate(a, class_id);
+      memset(x, 0xcd, size);
+      reallocated.insert(x);
+    }
+    EXPECT_EQ(std::set<void *>(allocated.begin(), allocated.end()),
+              reallocated);
+    for (std::set<void *>::iterator it = reallocated.begin();
+         it != reallocated.end(); ++it)
+      cache.Deallocate(a, class_id, *it);
+    cache.Drain(a);
+  }
+
+  a->TestOnlyUnmap();
+  delete a;
+}
+#endif  // SANITIZER_WORDSIZE == 64
+
+#if SANITIZER_WORDSIZE == 64
+// Checks the division-free chunk indices against the divisions, at chunk
+// boundaries up to the end of the regions.
+template <class Allocator>
+void SizeClassAllocatorChunkIdx() {
+  Allocator *a = new Allocator;
+  a->Init();
+  typedef typename Allocator::SizeClassMapT SizeClassMap;
+  const uptr kRegionSize = kAllocatorSize / SizeClassMap::kNumClassesRounded;
+  for (uptr class_id = 1; class_id < Allocator::kNumClasses; class_id++) {
+    uptr size = SizeClassMap::Size(class_id);
+    uptr region_beg = kAllocatorSpace + kRegionSize * class_id;
+    uptr region_end = region_beg + kRegionSize;
+    uptr num_chunks = kRegionSize / size;
+    for (uptr i = 0; i < 1000; i++) {
+      uptr chunk_idx = i < 500 ? i : num_chunks - (i - 500) - 1;
+      uptr offsets[] = {chunk_idx * size, chunk_idx * size + size / 2,
+                        chunk_idx * size + size - 1};
+      for (uptr j = 0; j < ARRAY_SIZE(offsets); j++) {
+        void *p = reinterpret_cast<void *>(region_beg + offsets[j]);
+        uptr meta = reinterpret_cast<uptr>(a->GetMetaData(p));
+        EXPECT_EQ(chunk_idx, (region_end - meta) / 16 - 1);
+      }
+    }
+  }
+  a->TestOnlyUnmap();
+  delete a;
+}
+
+TEST(SanitizerCommon, SizeClassAllocator64ChunkIdx) {
+  SizeClassAllocatorChunkIdx<Allocator64>();
+}
+
+TEST(SanitizerCommon, SizeClassAllocator64CompactChunkIdx) {
+  SizeClassAllocatorChunkIdx<Allocator64Compact>();
+}
+
+// Measures the latency of GetBlockBeginAndMetaData() on interior pointers
+// for each size class. Run with --gtest_also_run_disabled_tests.
+TEST(SanitizerCommon, DISABLED_SizeClassAllocator64LookupBenchmark) {
+  Allocator64 *a = new Allocator64;
+  a->Init();
+  SizeClassAllocatorLocalCache<Allocator64> cache;
+  memset(&cache, 0, sizeof(cache));
+  cache.Init(0);
+
+  const uptr kNumChunks = 64;
+  const uptr kNumIter = 1 << 16;
+  for (uptr class_id = 1; class_id < Allocator64::kNumClasses; class_id++) {
+    uptr size = Allocator64::SizeClassMapT::Size(class_id);
+    void *chunks[kNumChunks];
+    const void *interior[kNumChunks];
+    for (uptr i = 0; i < kNumChunks; i++) {
+      chunks[i] = cache.Allocate(a, class_id);
+      interior[i] = reinterpret_cast<char *>(chunks[i]) + (i * 7) % size;
+    }
+    uptr sink = 0;
+    uptr dep = 0;
+    u64 start = NanoTime();
+    for (uptr iter = 0; iter < kNumIter; iter++) {
+      for (uptr i = 0; i < kNumChunks; i++) {
+        void *meta;
+        void *beg = a->GetBlockBeginAndMetaData(
+            reinterpret_cast<const char *>(interior[i]) + dep, &meta);
+        // Always 0, but makes each lookup wait for the previous one.
+        dep = beg == 0;
+        sink += reinterpret_cast<uptr>(meta);
+      }
+    }
+    u64 elapsed = NanoTime() - start;
+    break_optimization(reinterpret_cast<void *>(sink));
+    fprintf(stderr, "c%02zd size %6zd: %.2f ns/lookup\n", class_id, size,
+            (double)elapsed / (kNumIter * kNumChunks));
+    for (uptr i = 0; i < kNumChunks; i++)
+      cache.Deallocate(a, class_id, chunks[i]);
+  }
+
+  a->TestOnlyUnmap();
+  delete a;
+}
+#endif  // SANITIZER_WORDSIZE == 64
+
 struct TestMapUnmapCallback {
   static int map_count, unmap_count;
   void OnMap(uptr p, uptr size) const { map_count++; }
@@ -156,8 +156,8 @@ FUNCTIONS.ubsan-i386 := $(UbsanFunctions)
 FUNCTIONS.ubsan-x86_64 := $(UbsanFunctions)
 FUNCTIONS.ubsan_cxx-i386 := $(UbsanCXXFunctions)
 FUNCTIONS.ubsan_cxx-x86_64 := $(UbsanCXXFunctions)
-FUNCTIONS.cver-i386 := $(CverFunctions)
-FUNCTIONS.cver-x86_64 := $(CverFunctions)
+FUNCTIONS.cver-i386 := $(CverFunctions) $(InterceptionFunctions)
+FUNCTIONS.cver-x86_64 := $(CverFunctions) $(InterceptionFunctions)
 FUNCTIONS.dfsan-x86_64 := $(DfsanFunctions) $(InterceptionFunctions) \
                                             $(SanitizerCommonFunctions)
 FUNCTIONS.lsan-x86_64 := $(LsanFunctions) $(InterceptionFunctions) \
@@ -0,0 +1,65 @@
+// REQUIRES: lto
+// RUN: %clangxx -fsanitize=cver -flto %s -O0 -c -o %t-1.o
+// RUN: %clangxx -fsanitize=cver -flto -DSECOND_TU %s -O0 -c -o %t-2.o
+// RUN: %clangxx -fsanitize=cver -flto -fuse-ld=gold %t-1.o %t-2.o -O0 -o %t
+// RUN: CVER_OPTIONS=no_cache=1:stats=1 %run %t 2>&1 | FileCheck %s
+
+// Under LTO, base memberships are answered by the cast bitmap. The types with
+// internal linkage share their mangled names across translation units, so
+// they are kept out of the bitmap.
+
+struct Token {
+  unsigned long pos;
+};
+
+struct Ident : Token {
+  unsigned long name;
+};
+
+struct Number : Token {
+  unsigned long value;
+};
+
+Token *make_second_keyword();
+Ident *cast_ident(Token *p);
+
+#ifndef SECOND_TU
+namespace {
+struct Keyword : Ident {
+  unsigned long kind;
+};
+}
+
+int main() {
+  Token *id = new Ident;
+  cast_ident(id);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: cast_bitmap.cc:[[@LINE+2]]:16: Casting from 'Ident' to 'Number'
+  // CHECK: == End of reports.
+  Number *pn = static_cast<Number*>(id);
+
+  Token *kw = new Keyword;
+  cast_ident(kw);
+  cast_ident(make_second_keyword());
+  return 0;
+}
+#else
+namespace {
+// Unlike Keyword of the first translation unit, this is not an Ident.
+struct Keyword : Token {
+  unsigned long kind;
+};
+}
+
+Token *make_second_keyword() {
+  return new Keyword;
+}
+
+__attribute__((noinline)) Ident *cast_ident(Token *p) {
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: cast_bitmap.cc:[[@LINE+2]]:10: Casting from '{{.*}}Keyword' to 'Ident'
+  // CHECK: == End of reports.
+  return static_cast<Ident*>(p);
+}
+// CHECK: Stats: {{[1-9][0-9]*}} cast bitmap hit
+#endif
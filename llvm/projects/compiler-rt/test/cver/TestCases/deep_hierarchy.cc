@@ -0,0 +1,31 @@
+// RUN: %clangxx -fsanitize=cver %s -O0 -o %t
+// RUN: CVER_OPTIONS=no_cache=1 %run %t 2>&1 | FileCheck %s --strict-whitespace
+
+// The base type membership is tested through the base set of THTable. Check
+// it on a deep hierarchy, both for good and bad castings.
+
+template <int N> struct D : D<N-1> {
+  int d;
+};
+
+template <> struct D<0> {
+  int base;
+};
+
+int main(int argc, char **argv) {
+  D<0> *p64 = new D<64>;
+  D<0> *p32 = new D<32>;
+
+  // CHECK-NOT: Casting from 'D<64>'
+  static_cast<D<64>*>(p64);
+  static_cast<D<32>*>(p64);
+  static_cast<D<1>*>(p64);
+
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: deep_hierarchy.cc:[[@LINE+2]]:3: Casting from 'D<32>' to 'D<64>'
+  // CHECK: == End of reports.
+  static_cast<D<64>*>(p32);
+  // CHECK-NOT: Casting from 'D<32>' to 'D<31>'
+  static_cast<D<31>*>(p32);
+  return 0;
+}
@@ -0,0 +1,67 @@
+// RUN: %clangxx -fsanitize=cver -DBUILD_SO -fPIC -shared %s -O0 -o %t-so.so
+// RUN: %clangxx -fsanitize=cver %s -O0 -o %t -ldl
+// RUN: CVER_OPTIONS=no_cache=1 %run %t %t-so.so 2>&1 | FileCheck %s --strict-whitespace
+
+// Global objects of a module are located while it is loaded, and registered
+// again when it is loaded again. Unloading it leaves the globals of the other
+// modules registered.
+
+#include <dlfcn.h>
+#include <stdio.h>
+
+struct Config {
+  unsigned long version;
+};
+
+struct FileConfig : Config {
+  unsigned long fd;
+};
+
+struct NetConfig : Config {
+  unsigned long port;
+};
+
+#ifdef BUILD_SO
+FileConfig so_config;
+
+extern "C" Config *get_config() {
+  return &so_config;
+}
+#else
+NetConfig main_config;
+
+static void *handle;
+
+static Config *load_config(const char *path) {
+  handle = dlopen(path, RTLD_NOW);
+  if (!handle) {
+    fprintf(stderr, "dlopen: %s\n", dlerror());
+    return 0;
+  }
+  Config *(*get_config)() = (Config *(*)())dlsym(handle, "get_config");
+  return get_config();
+}
+
+int main(int argc, char **argv) {
+  Config *c = load_config(argv[1]);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: global_dlclose.cc:[[@LINE+2]]:19: Casting from 'FileConfig' to 'NetConfig'
+  // CHECK: == End of reports.
+  NetConfig *pn = static_cast<NetConfig*>(c);
+  dlclose(handle);
+
+  c = load_config(argv[1]);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: global_dlclose.cc:[[@LINE+2]]:8: Casting from 'FileConfig' to 'NetConfig'
+  // CHECK: == End of reports.
+  pn = static_cast<NetConfig*>(c);
+  dlclose(handle);
+
+  c = &main_config;
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: global_dlclose.cc:[[@LINE+2]]:20: Casting from 'NetConfig' to 'FileConfig'
+  // CHECK: == End of reports.
+  FileConfig *pf = static_cast<FileConfig*>(c);
+  return 0;
+}
+#endif
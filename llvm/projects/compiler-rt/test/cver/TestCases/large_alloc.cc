@@ -0,0 +1,43 @@
+// RUN: %clangxx -fsanitize=cver %s -O0 -o %t
+// RUN: CVER_OPTIONS=no_cache=1 %run %t 2>&1 | FileCheck %s --strict-whitespace
+
+// Objects allocated by the secondary allocator, which are larger than any
+// size class, are tracked as well, both as single objects and as arrays up to
+// their last elements.
+
+struct Block {
+  unsigned long id;
+};
+
+struct Inode : Block {
+  unsigned long mode;
+};
+
+struct Extent : Block {
+  unsigned long pages[1 << 17];
+};
+
+int main(int argc, char **argv) {
+  const int kNumInodes = 1 << 16;
+  Inode *inodes = new Inode[kNumInodes];
+  Block *pb = &inodes[1000];
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: large_alloc.cc:[[@LINE+2]]:16: Casting from 'Inode' to 'Extent'
+  // CHECK: == End of reports.
+  Extent *pe = static_cast<Extent*>(pb);
+  pb = &inodes[kNumInodes - 1];
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: large_alloc.cc:[[@LINE+2]]:8: Casting from 'Inode' to 'Extent'
+  // CHECK: == End of reports.
+  pe = static_cast<Extent*>(pb);
+  delete[] inodes;
+
+  pb = new Extent;
+  Extent *pgood = static_cast<Extent*>(pb);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: large_alloc.cc:[[@LINE+2]]:15: Casting from 'Extent' to 'Inode'
+  // CHECK: == End of reports.
+  Inode *pi = static_cast<Inode*>(pb);
+  delete pb;
+  return 0;
+}
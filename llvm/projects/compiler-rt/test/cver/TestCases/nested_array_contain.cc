@@ -0,0 +1,41 @@
+// RUN: %clangxx -fsanitize=cver %s -O0 -o %t
+// RUN: CVER_OPTIONS=no_cache=1 %run %t 2>&1 | FileCheck %s --strict-whitespace
+
+// Nested arrays, each small enough to be expanded per element, are summarized
+// once their expansions together exceed the interval limit of the flattened
+// containment vector.
+
+class S { int _s; };
+class T : public S { int _t; };
+class U : public S { int _u; };
+class V : public S { int _v; };
+
+class Element {
+public:
+  T elemT;
+  U elemU;
+};
+class Row {
+public:
+  Element elems[200];
+};
+class Grid {
+public:
+  int _dummy;
+  Row rows[200];
+};
+
+int main(int argc, char **argv) {
+  Grid *pg = new Grid();
+
+  // CHECK-NOT: Casting from 'Grid' to 'T'
+  S *ps = &(pg->rows[199].elems[199].elemT);
+  T *pt = static_cast<T*>(ps); // benign casting
+
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: nested_array_contain.cc:[[@LINE+3]]:11: Casting from 'Grid' to 'V'
+  // CHECK: == End of reports.
+  ps = &(pg->rows[100].elems[7].elemU);
+  V *pv = static_cast<V*>(ps); // bad down-casting
+  return 0;
+}
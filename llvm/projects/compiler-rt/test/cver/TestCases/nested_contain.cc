@@ -0,0 +1,39 @@
+// RUN: %clangxx -fsanitize=cver %s -O0 -o %t
+// RUN: CVER_OPTIONS=no_cache=1 %run %t 2>&1 | FileCheck %s --strict-whitespace
+
+// Containments of containments (including the ones in the array elements) are
+// checked through the flattened containment vector.
+
+class S { int _s; };
+class T : public S { int _t; };
+class U : public S { int _u; };
+
+class Inner {
+public:
+  int _dummy;
+  T innerT;
+};
+class Element : public Inner {
+public:
+  U elemU;
+};
+class Outer {
+public:
+  char _dummy[24];
+  Element elems[4];
+};
+
+int main(int argc, char **argv) {
+  Outer *po = new Outer();
+
+  // CHECK-NOT: Casting from 'Outer' to 'T'
+  S *ps = &(po->elems[2].innerT);
+  T *pt = static_cast<T*>(ps); // benign casting
+
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: nested_contain.cc:[[@LINE+3]]:11: Casting from 'Outer' to 'T'
+  // CHECK: == End of reports.
+  ps = &(po->elems[3].elemU);
+  pt = static_cast<T*>(ps); // bad down-casting
+  return 0;
+}
@@ -0,0 +1,90 @@
+// RUN: %clangxx -fsanitize=cver %s -O0 -o %t
+// RUN: CVER_OPTIONS=no_cache=1 %run %t 2>&1 | FileCheck %s --strict-whitespace
+
+// The type and the element size of a chunk are packed into one word. Array
+// elements are located by the element size, and a chunk reused for another
+// object, by the allocator or by a class-specific operator new, takes the
+// type of the new object.
+
+#include <stdlib.h>
+
+struct Item {
+  unsigned long price;
+};
+
+struct Book : Item {
+  unsigned long pages;
+};
+
+struct Disc : Item {
+  unsigned long tracks;
+};
+
+static void *pool;
+
+// Both are allocated from the same 64-byte chunk.
+struct Coupon : Item {
+  unsigned long code;
+  void *operator new(size_t) { return pool; }
+  void *operator new[](size_t) { return pool; }
+  void operator delete(void *) {}
+  void operator delete[](void *) {}
+};
+
+struct Voucher : Item {
+  unsigned long amount;
+  void *operator new(size_t) { return pool; }
+  void *operator new[](size_t) { return pool; }
+  void operator delete(void *) {}
+  void operator delete[](void *) {}
+};
+
+int main(int argc, char **argv) {
+  // Every element of an array is located.
+  Book *books = new Book[argc + 7];
+  Item *pi = &books[argc + 6];
+  Book *pb = static_cast<Book*>(pi);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: packed_metadata.cc:[[@LINE+2]]:14: Casting from 'Book' to 'Disc'
+  // CHECK: == End of reports.
+  Disc *pd = static_cast<Disc*>(pi);
+  delete[] books;
+
+  // The chunk freed above is likely reused, but typed anew.
+  Disc *discs = new Disc[argc + 7];
+  pi = &discs[argc + 6];
+  pd = static_cast<Disc*>(pi);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: packed_metadata.cc:[[@LINE+2]]:8: Casting from 'Disc' to 'Book'
+  // CHECK: == End of reports.
+  pb = static_cast<Book*>(pi);
+  delete[] discs;
+
+  pool = malloc(64);
+
+  pi = new Coupon;
+  Coupon *pc = static_cast<Coupon*>(pi);
+  delete pc;
+
+  // The chunk of Coupon is typed again.
+  pi = new Voucher;
+  Voucher *pv = static_cast<Voucher*>(pi);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: packed_metadata.cc:[[@LINE+2]]:8: Casting from 'Voucher' to 'Coupon'
+  // CHECK: == End of reports.
+  pc = static_cast<Coupon*>(pi);
+  delete pv;
+
+  // And again as an array, whose elements fill the chunk.
+  Coupon *coupons = new Coupon[4];
+  pi = &coupons[3];
+  pc = static_cast<Coupon*>(pi);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: packed_metadata.cc:[[@LINE+2]]:8: Casting from 'Coupon' to 'Voucher'
+  // CHECK: == End of reports.
+  pv = static_cast<Voucher*>(pi);
+  delete[] coupons;
+
+  free(pool);
+  return 0;
+}
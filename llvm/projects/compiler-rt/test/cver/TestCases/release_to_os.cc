@@ -0,0 +1,42 @@
+// RUN: %clangxx -fsanitize=cver %s -O0 -o %t
+// RUN: CVER_OPTIONS=stats=1:release_to_os_threshold=1 %run %t 2>&1 | FileCheck %s
+
+// The free pages of the allocator are returned to the OS, and the chunks
+// on them are allocated and typed again afterwards.
+
+#include <stdlib.h>
+
+struct Entry {
+  unsigned long inode;
+};
+
+struct FileEntry : Entry {
+  unsigned long size;
+};
+
+struct DirEntry : Entry {
+  unsigned long children;
+};
+
+static const int kNumEntries = 1 << 16;
+static FileEntry *entries[kNumEntries];
+
+int main() {
+  for (int round = 0; round < 4; round++) {
+    for (int i = 0; i < kNumEntries; i++)
+      entries[i] = new FileEntry[4];
+    for (int i = 0; i < kNumEntries; i++)
+      delete[] entries[i];
+  }
+
+  // Likely on a page released above.
+  DirEntry *dirs = new DirEntry[4];
+  Entry *pe = &dirs[1];
+  DirEntry *pd = static_cast<DirEntry*>(pe);
+  // CHECK-NOT: Casting from 'FileEntry'
+  // CHECK: release_to_os.cc:[[@LINE+1]]:19: Casting from 'DirEntry' to 'FileEntry'
+  FileEntry *pf = static_cast<FileEntry*>(pe);
+  delete[] dirs;
+  // CHECK: Stats: {{[0-9]+}}M released to the OS by {{[1-9][0-9]*}} calls
+  return 0;
+}
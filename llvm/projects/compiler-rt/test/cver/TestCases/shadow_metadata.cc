@@ -0,0 +1,54 @@
+// RUN: %clangxx -fsanitize=cver %s -O0 -o %t
+// RUN: CVER_OPTIONS=no_cache=1:shadow_metadata=1 %run %t 2>&1 | FileCheck %s --strict-whitespace
+
+// Heap objects are typed in shadow memory, while the real allocator serves
+// the allocations. A chunk the real allocator hands out again is typed anew.
+
+#include <malloc.h>
+#include <stdlib.h>
+
+struct Packet {
+  unsigned long len;
+};
+
+struct TcpPacket : Packet {
+  unsigned long seq;
+};
+
+struct UdpPacket : Packet {
+  unsigned long port;
+};
+
+int main(int argc, char **argv) {
+  Packet *p = new TcpPacket;
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: shadow_metadata.cc:[[@LINE+2]]:19: Casting from 'TcpPacket' to 'UdpPacket'
+  // CHECK: == End of reports.
+  UdpPacket *pu = static_cast<UdpPacket*>(p);
+  delete p;
+
+  // Likely at the address of the freed TcpPacket.
+  p = new UdpPacket;
+  pu = static_cast<UdpPacket*>(p);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: shadow_metadata.cc:[[@LINE+2]]:19: Casting from 'UdpPacket' to 'TcpPacket'
+  // CHECK: == End of reports.
+  TcpPacket *pt = static_cast<TcpPacket*>(p);
+  delete p;
+
+  TcpPacket *tcps = new TcpPacket[argc + 7];
+  p = &tcps[argc + 6];
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: shadow_metadata.cc:[[@LINE+2]]:8: Casting from 'TcpPacket' to 'UdpPacket'
+  // CHECK: == End of reports.
+  pu = static_cast<UdpPacket*>(p);
+  delete[] tcps;
+
+  // The untyped buffers work as before.
+  char *buf = (char *)malloc(100);
+  buf = (char *)realloc(buf, 1000);
+  if (malloc_usable_size(buf) < 1000)
+    return 1;
+  free(buf);
+  return 0;
+}
@@ -0,0 +1,50 @@
+// RUN: %clangxx -fsanitize=cver -fsanitize=cver-stack %s -O0 -o %t
+// RUN: CVER_OPTIONS=no_cache=1 %run %t 2>&1 | FileCheck %s --strict-whitespace
+
+// Stack objects of outer frames are still located after the objects of inner
+// frames are gone, and scoped objects are removed on their scope exits.
+
+struct Vehicle {
+  unsigned long wheels;
+};
+
+struct Car : Vehicle {
+  unsigned long seats;
+};
+
+struct Truck : Vehicle {
+  unsigned long load;
+};
+
+__attribute__((noinline)) void drive(Vehicle *outer, int depth) {
+  Truck truck;
+  Car car;
+  if (depth > 0) {
+    drive(&car, depth - 1);
+    return;
+  }
+  Vehicle *pt = &truck;
+  Truck *pgood = static_cast<Truck*>(pt);
+  // The car of the caller.
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: shadow_stack.cc:[[@LINE+2]]:17: Casting from 'Car' to 'Truck'
+  // CHECK: == End of reports.
+  Truck *pbad = static_cast<Truck*>(outer);
+}
+
+int main(int argc, char **argv) {
+  Car outer;
+  Vehicle *po = &outer;
+  drive(&outer, 8);
+
+  {
+    Truck scoped;
+    Vehicle *ps = &scoped;
+    Truck *pgood = static_cast<Truck*>(ps);
+  }
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: shadow_stack.cc:[[@LINE+2]]:17: Casting from 'Car' to 'Truck'
+  // CHECK: == End of reports.
+  Truck *pbad = static_cast<Truck*>(po);
+  return 0;
+}
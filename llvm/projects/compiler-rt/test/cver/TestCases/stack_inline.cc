@@ -0,0 +1,67 @@
+// RUN: %clangxx -fsanitize=cver -fsanitize=cver-stack -fsanitize-cver-stack-inline %s -O0 -o %t
+// RUN: CVER_OPTIONS=no_cache=1 %run %t 2>&1 | FileCheck %s --strict-whitespace
+
+// Stack objects registered inline are located by the runtime, and popped
+// inline on scope exits, so that a later frame placing an unregistered object
+// at the same address is not checked against them.
+
+#include <stdio.h>
+
+struct Shape {
+  unsigned long kind;
+};
+
+struct Circle : Shape {
+  unsigned long radius;
+};
+
+struct Square : Shape {
+  unsigned long side;
+};
+
+static Shape *last_circle;
+
+__attribute__((noinline)) void draw_circle() {
+  Circle c;
+  last_circle = &c;
+  Circle *pc = static_cast<Circle*>(last_circle);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: stack_inline.cc:[[@LINE+2]]:16: Casting from 'Circle' to 'Square'
+  // CHECK: == End of reports.
+  Square *ps = static_cast<Square*>(last_circle);
+}
+
+__attribute__((noinline)) void draw_raw() {
+  // Covers the frame of draw_circle(), but is not registered.
+  unsigned long raw[64];
+  if ((unsigned long *)last_circle >= raw &&
+      (unsigned long *)last_circle < raw + 64)
+    fprintf(stderr, "Reused the address of the circle\n");
+  // CHECK-NOT: == CastVerifier Bad-casting Reports
+  // CHECK: Reused the address of the circle
+  // CHECK-NOT: == CastVerifier Bad-casting Reports
+  Square *ps = static_cast<Square*>(last_circle);
+}
+
+__attribute__((noinline)) void draw_nested(Shape *outer, int depth) {
+  Circle c;
+  Square s;
+  if (depth > 0) {
+    draw_nested(&c, depth - 1);
+    return;
+  }
+  Square *ps = static_cast<Square*>(static_cast<Shape*>(&s));
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: stack_inline.cc:[[@LINE+2]]:16: Casting from 'Circle' to 'Square'
+  // CHECK: == End of reports.
+  Square *po = static_cast<Square*>(outer);
+}
+
+int main(int argc, char **argv) {
+  draw_circle();
+  draw_raw();
+  draw_nested(0, 8);
+  fprintf(stderr, "Done\n");
+  // CHECK: Done
+  return 0;
+}
@@ -0,0 +1,54 @@
+// RUN: %clangxx -fsanitize=cver -fsanitize=cver-stack -fsanitize-cver-stack-inline %s -O0 -o %t
+// RUN: CVER_OPTIONS=no_cache=1 %run %t 2>&1 | FileCheck %s --strict-whitespace
+
+// Deep recursions pop their entries inline on the way back, so the runtime,
+// which is called only at the bottom of the next recursion, finds the entries
+// of that recursion alone, even though they are placed at the addresses of
+// the previous one.
+
+struct Node {
+  unsigned long id;
+};
+
+struct Leaf : Node {
+  unsigned long value;
+};
+
+struct Branch : Node {
+  unsigned long children;
+};
+
+__attribute__((noinline)) void grow_leaves(Node *parent, int depth) {
+  Leaf l1;
+  Leaf l2;
+  if (depth > 0)
+    grow_leaves(&l2, depth - 1);
+}
+
+__attribute__((noinline)) void grow_branches(Node *parent, int depth) {
+  Branch b;
+  Leaf l;
+  if (depth > 0) {
+    grow_branches(&b, depth - 1);
+    return;
+  }
+  // The Branch placed where a Leaf was.
+  Branch *pb = static_cast<Branch*>(static_cast<Node*>(&b));
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: stack_inline_deep.cc:[[@LINE+2]]:16: Casting from 'Leaf' to 'Branch'
+  // CHECK: == End of reports.
+  Branch *pl = static_cast<Branch*>(static_cast<Node*>(&l));
+  // CHECK-NOT: == CastVerifier Bad-casting Reports
+  Branch *pp = static_cast<Branch*>(parent);
+}
+
+int main(int argc, char **argv) {
+  Leaf root;
+  grow_leaves(&root, 20000);
+  grow_branches(&root, 20000);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: stack_inline_deep.cc:[[@LINE+2]]:19: Casting from 'Leaf' to 'Branch'
+  // CHECK: == End of reports.
+  Branch *proot = static_cast<Branch*>(static_cast<Node*>(&root));
+  return 0;
+}
@@ -0,0 +1,67 @@
+// RUN: %clangxx -fsanitize=cver -fsanitize=cver-stack -fsanitize-cver-stack-no-exit %s -O0 -o %t
+// RUN: CVER_OPTIONS=no_cache=1 %run %t 2>&1 | FileCheck %s --strict-whitespace
+
+// Without __cver_handle_stack_exit, the entries of exited frames are discarded
+// by the stack pointer, or by the new objects overlapping them. The entries
+// left over the unregistered objects of a later frame are not discarded, so
+// such objects are checked against the stale entries.
+
+#include <stdio.h>
+
+struct Fruit {
+  unsigned long weight;
+};
+
+struct Apple : Fruit {
+  unsigned long seeds;
+};
+
+struct Pear : Fruit {
+  unsigned long stem;
+};
+
+static Fruit *last_apple;
+
+__attribute__((noinline)) void pick_pear() {
+  // Overlaps the stale entry of the apple of the last pick_apple().
+  Pear p;
+  Fruit *pf = &p;
+  Pear *pp = static_cast<Pear*>(pf);
+}
+
+__attribute__((noinline)) void pick_apple() {
+  Apple a;
+  last_apple = &a;
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: stack_no_exit.cc:[[@LINE+2]]:14: Casting from 'Apple' to 'Pear'
+  // CHECK: == End of reports.
+  Pear *pp = static_cast<Pear*>(last_apple);
+}
+
+__attribute__((noinline)) void pick_raw() {
+  // Covers the frame of pick_apple(), but is not registered.
+  unsigned long raw[64];
+  if ((unsigned long *)last_apple >= raw &&
+      (unsigned long *)last_apple < raw + 64)
+    fprintf(stderr, "Reused the address of the apple\n");
+  // CHECK: Reused the address of the apple
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: stack_no_exit.cc:[[@LINE+2]]:14: Casting from 'Apple' to 'Pear'
+  // CHECK: == End of reports.
+  Pear *pp = static_cast<Pear*>(last_apple);
+}
+
+int main(int argc, char **argv) {
+  Apple outer;
+  Fruit *po = &outer;
+  for (int i = 0; i < 4; i++) {
+    pick_pear();
+    pick_apple();
+  }
+  pick_raw();
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: stack_no_exit.cc:[[@LINE+2]]:14: Casting from 'Apple' to 'Pear'
+  // CHECK: == End of reports.
+  Pear *pp = static_cast<Pear*>(po);
+  return 0;
+}
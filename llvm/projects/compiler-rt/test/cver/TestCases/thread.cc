@@ -0,0 +1,58 @@
+// RUN: %clangxx -fsanitize=cver -fsanitize=cver-stack %s -O0 -pthread -o %t
+// RUN: CVER_OPTIONS=no_cache=1 %run %t 2>&1 | FileCheck %s --strict-whitespace
+
+// Objects allocated by other threads than the main thread are tracked on their
+// own stacks and allocator caches. The heap objects stay typed after their
+// thread exits, and the stack of the main thread is left intact.
+
+#include <pthread.h>
+
+struct Task {
+  unsigned long id;
+};
+
+struct ReadTask : Task {
+  unsigned long fd;
+};
+
+struct WriteTask : Task {
+  unsigned long len;
+};
+
+void *worker(void *arg) {
+  Task *heap = new ReadTask;
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: thread.cc:[[@LINE+2]]:19: Casting from 'ReadTask' to 'WriteTask'
+  // CHECK: == End of reports.
+  WriteTask *pw = static_cast<WriteTask*>(heap);
+
+  WriteTask stack;
+  Task *ps = &stack;
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: thread.cc:[[@LINE+2]]:18: Casting from 'WriteTask' to 'ReadTask'
+  // CHECK: == End of reports.
+  ReadTask *pr = static_cast<ReadTask*>(ps);
+  return heap;
+}
+
+int main(int argc, char **argv) {
+  ReadTask mine;
+  Task *pm = &mine;
+  Task *heap;
+  pthread_t t;
+  pthread_create(&t, 0, worker, 0);
+  pthread_join(t, (void **)&heap);
+
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: thread.cc:[[@LINE+2]]:19: Casting from 'ReadTask' to 'WriteTask'
+  // CHECK: == End of reports.
+  WriteTask *pw = static_cast<WriteTask*>(heap);
+  // Freed into the cache of the main thread.
+  delete heap;
+
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: thread.cc:[[@LINE+2]]:19: Casting from 'ReadTask' to 'WriteTask'
+  // CHECK: == End of reports.
+  WriteTask *pn = static_cast<WriteTask*>(pm);
+  return 0;
+}
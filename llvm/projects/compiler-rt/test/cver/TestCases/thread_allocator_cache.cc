@@ -0,0 +1,39 @@
+// RUN: %clangxx -fsanitize=cver %s -O0 -pthread -o %t
+// RUN: CVER_OPTIONS=stats=1 %run %t 2>&1 | FileCheck %s
+
+// The allocator caches of many short-lived threads are allocated on demand,
+// and freed when the threads exit.
+
+#include <pthread.h>
+#include <stdio.h>
+
+struct S {
+  unsigned long s;
+};
+
+struct T : S {
+  unsigned long t;
+};
+
+static const int kNumThreads = 256;
+
+static void *worker(void *arg) {
+  for (int i = 0; i < 1000; i++)
+    delete new T;
+  return 0;
+}
+
+int main() {
+  pthread_t threads[kNumThreads];
+  for (int i = 0; i < kNumThreads; i++)
+    pthread_create(&threads[i], 0, worker, 0);
+  for (int i = 0; i < kNumThreads; i++)
+    pthread_join(threads[i], 0);
+  // CHECK: done
+  printf("done\n");
+  // Only the main thread's cache, with the few classes it used, is left.
+  // CHECK: Stats: {{[0-9][0-9]?}}K in per-thread allocator caches; {{[0-9]+}} grows
+  // Each thread used a few classes only.
+  // CHECK: Stats: {{[0-9][0-9]?}}K in the largest per-thread allocator cache
+  return 0;
+}
@@ -0,0 +1,40 @@
+// RUN: %clangxx -fsanitize=cver %s -O0 -c -DALLOC -o %t-alloc.o
+// RUN: %clangxx -fsanitize=cver %s -O0 -c -o %t-cast.o
+// RUN: %clangxx -fsanitize=cver %t-alloc.o %t-cast.o -o %t
+// RUN: CVER_OPTIONS=verbose=1 %run %t 2>&1 | FileCheck %s --strict-whitespace
+
+// THTables of externally visible types are merged across translation units,
+// so the allocated type is matched with the target type by the pointer.
+
+struct S {
+  unsigned long s;
+};
+
+struct T : S {
+  unsigned long t;
+};
+
+struct U : S {
+  unsigned long u;
+};
+
+#ifdef ALLOC
+S *alloc() {
+  return new T;
+}
+#else
+S *alloc();
+
+int main(int argc, char **argv) {
+  S *p = alloc();
+
+  // CHECK: Same THTable
+  T *pt = static_cast<T*>(p);
+
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: thtable_dedup.cc:[[@LINE+1]]:11: Casting from 'T' to 'U'
+  U *pu = static_cast<U*>(p);
+  // CHECK: == End of reports.
+  return 0;
+}
+#endif
@@ -0,0 +1,46 @@
+// RUN: %clangxx -fsanitize=cver -fsanitize-cver-typed-new %s -O0 -o %t
+// RUN: CVER_OPTIONS=no_cache=1 %run %t 2>&1 | FileCheck %s --strict-whitespace
+
+// With -fsanitize-cver-typed-new, objects are allocated and typed in one
+// runtime call, for single objects, and for arrays with and without a cookie.
+
+struct Message {
+  unsigned long id;
+};
+
+struct Request : Message {
+  unsigned long method;
+};
+
+// The non-trivial destructor puts an array cookie before the elements.
+struct Reply : Message {
+  ~Reply() {}
+  unsigned long status;
+};
+
+int main(int argc, char **argv) {
+  Message *req = new Request;
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: typed_new.cc:[[@LINE+2]]:16: Casting from 'Request' to 'Reply'
+  // CHECK: == End of reports.
+  Reply *prp = static_cast<Reply*>(req);
+  delete req;
+
+  Request *reqs = new Request[argc + 3];
+  Message *pm = &reqs[argc + 1];
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: typed_new.cc:[[@LINE+2]]:17: Casting from 'Request' to 'Reply'
+  // CHECK: == End of reports.
+  Reply *preq = static_cast<Reply*>(pm);
+  delete[] reqs;
+
+  Reply *reps = new Reply[argc + 3];
+  pm = &reps[argc + 1];
+  Reply *prep = static_cast<Reply*>(pm);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: typed_new.cc:[[@LINE+2]]:18: Casting from 'Reply' to 'Request'
+  // CHECK: == End of reports.
+  Request *prq = static_cast<Request*>(pm);
+  delete[] reps;
+  return 0;
+}
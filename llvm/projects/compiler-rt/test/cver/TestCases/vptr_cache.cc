@@ -0,0 +1,38 @@
+// RUN: %clangxx -fsanitize=cver %s -O3 -o %t
+// RUN: %run %t 2>&1 | FileCheck %s --strict-whitespace
+// RUN: CVER_OPTIONS=no_cache=1 %run %t 2>&1 | FileCheck %s --strict-whitespace
+
+// Good casts on polymorphic objects are cached in __cver_vptr_type_cache, and
+// must not hide bad-castings on the objects of the other types.
+
+struct S {
+  virtual ~S() {}
+  int s;
+};
+
+struct T : S {
+  int t;
+};
+
+struct U : S {
+  int u;
+};
+
+__attribute__((noinline)) T *cast(S *p) {
+  return static_cast<T*>(p);
+}
+
+int main(int argc, char **argv) {
+  S *pt = new T;
+  for (int i = 0; i < 100; i++)
+    cast(pt);
+
+  S *pu = new U;
+  for (int i = 0; i < 2; i++) {
+    // CHECK: == CastVerifier Bad-casting Reports
+    // CHECK: vptr_cache.cc:22:10: Casting from 'U' to 'T'
+    // CHECK: == End of reports.
+    cast(pu);
+  }
+  return 0;
+}
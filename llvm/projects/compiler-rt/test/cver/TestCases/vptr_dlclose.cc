@@ -0,0 +1,83 @@
+// RUN: %clangxx -fsanitize=cver -DBUILD_SO_SAVINGS -fPIC -shared %s -O0 -o %t-savings.so
+// RUN: %clangxx -fsanitize=cver -DBUILD_SO_CHECKING -fPIC -shared %s -O0 -o %t-checking.so
+// RUN: %clangxx -fsanitize=cver %s -O0 -o %t -ldl
+// RUN: CVER_OPTIONS=no_cache=1 %run %t %t-savings.so %t-checking.so 2>&1 | FileCheck %s --strict-whitespace
+
+// The vtables of a module are unregistered when it is unloaded, so that a
+// module loaded at the same address is not checked against them, and they
+// are registered again when the module is loaded again.
+
+#include <dlfcn.h>
+#include <stdio.h>
+
+struct Account {
+  virtual ~Account() {}
+  unsigned long balance;
+};
+
+struct Checking : Account {
+  unsigned long overdraft;
+};
+
+#if defined(BUILD_SO_SAVINGS)
+struct Savings : Account {
+  unsigned long rate;
+};
+
+extern "C" Account *open_account() {
+  return new Savings;
+}
+#elif defined(BUILD_SO_CHECKING)
+extern "C" Account *open_account() {
+  return new Checking;
+}
+#else
+static void *handle;
+
+static Account *open_account(const char *path) {
+  handle = dlopen(path, RTLD_NOW);
+  if (!handle) {
+    fprintf(stderr, "dlopen: %s\n", dlerror());
+    return 0;
+  }
+  Account *(*open)() = (Account *(*)())dlsym(handle, "open_account");
+  return open();
+}
+
+static void close_account(Account *a) {
+  delete a;
+  dlclose(handle);
+  fprintf(stderr, "closed\n");
+}
+
+int main(int argc, char **argv) {
+  Account *a = open_account(argv[1]);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: vptr_dlclose.cc:[[@LINE+2]]:18: Casting from 'Savings' to 'Checking'
+  // CHECK: == End of reports.
+  Checking *pc = static_cast<Checking*>(a);
+  close_account(a);
+  // CHECK: closed
+
+  // The vtable of Checking may be placed at the address of Savings.
+  a = open_account(argv[2]);
+  pc = static_cast<Checking*>(a);
+  close_account(a);
+  // CHECK-NOT: Casting from
+  // CHECK: closed
+
+  a = open_account(argv[2]);
+  pc = static_cast<Checking*>(a);
+  close_account(a);
+  // CHECK-NOT: Casting from
+  // CHECK: closed
+
+  a = open_account(argv[1]);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: vptr_dlclose.cc:[[@LINE+2]]:8: Casting from 'Savings' to 'Checking'
+  // CHECK: == End of reports.
+  pc = static_cast<Checking*>(a);
+  close_account(a);
+  return 0;
+}
+#endif
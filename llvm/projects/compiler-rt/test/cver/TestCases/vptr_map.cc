@@ -0,0 +1,53 @@
+// RUN: %clangxx -fsanitize=cver %s -O0 -o %t
+// RUN: CVER_OPTIONS=no_cache=1 %run %t 2>&1 | FileCheck %s --strict-whitespace
+
+// Polymorphic objects are located by their vptrs, so bad-castings are detected
+// without the per-allocation metadata, even through secondary vptrs.
+
+struct Clickable {
+  virtual ~Clickable() {}
+  unsigned long clicks;
+};
+
+struct Widget {
+  virtual ~Widget() {}
+  unsigned long id;
+};
+
+struct Button : Clickable, Widget {
+  unsigned long state;
+};
+
+struct Label : Widget {
+  unsigned long text;
+};
+
+Button global_button;
+
+int main(int argc, char **argv) {
+  // Widget is the secondary base of Button.
+  Widget *heap = new Button;
+  Button *pb = static_cast<Button*>(heap);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: vptr_map.cc:[[@LINE+2]]:15: Casting from 'Button' to 'Label'
+  // CHECK: == End of reports.
+  Label *pl = static_cast<Label*>(heap);
+  delete heap;
+
+  Label stack;
+  Widget *ps = &stack;
+  Label *pls = static_cast<Label*>(ps);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: vptr_map.cc:[[@LINE+2]]:17: Casting from 'Label' to 'Button'
+  // CHECK: == End of reports.
+  Button *pbs = static_cast<Button*>(ps);
+
+  Widget *pg = &global_button;
+  Clickable *pc = &global_button;
+  Button *pbc = static_cast<Button*>(pc);
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: vptr_map.cc:[[@LINE+2]]:16: Casting from 'Button' to 'Label'
+  // CHECK: == End of reports.
+  Label *plg = static_cast<Label*>(pg);
+  return 0;
+}
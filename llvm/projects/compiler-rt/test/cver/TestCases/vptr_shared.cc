@@ -0,0 +1,49 @@
+// RUN: %clangxx -fsanitize=cver -DBUILD_SO -fPIC -shared %s -O0 -o %t.so
+// RUN: %clangxx -fsanitize=cver -rdynamic %s -O0 -o %t -ldl
+// RUN: CVER_OPTIONS=no_cache=1 %run %t %t.so 2>&1 | FileCheck %s --strict-whitespace
+
+// A vtable registered by both the program and a module stays registered when
+// the module is unloaded, as the program still uses it.
+
+#include <dlfcn.h>
+#include <stdio.h>
+
+struct Animal {
+  virtual ~Animal() {}
+  unsigned long legs;
+};
+
+struct Cat : Animal {
+  unsigned long lives;
+};
+
+struct Dog : Animal {
+  unsigned long tricks;
+};
+
+#if defined(BUILD_SO)
+// Registers the vtable of Cat again, which resolves to the copy of the
+// program.
+extern "C" Animal *adopt() {
+  return new Cat;
+}
+#else
+int main(int argc, char **argv) {
+  Animal *cat = new Cat;
+  void *handle = dlopen(argv[1], RTLD_NOW);
+  if (!handle) {
+    fprintf(stderr, "dlopen: %s\n", dlerror());
+    return 1;
+  }
+  Animal *(*adopt)() = (Animal *(*)())dlsym(handle, "adopt");
+  delete adopt();
+  dlclose(handle);
+  fprintf(stderr, "closed\n");
+  // CHECK: closed
+  // CHECK: == CastVerifier Bad-casting Reports
+  // CHECK: vptr_shared.cc:[[@LINE+2]]:14: Casting from 'Cat' to 'Dog'
+  // CHECK: == End of reports.
+  Dog *dog = static_cast<Dog*>(cat);
+  return 0;
+}
+#endif
@@ -0,0 +1,103 @@
+; RUN: opt < %s -cver-prune-stack -S | FileCheck %s
+; Check that the stack hooks tagged with !cver.stack.inline are pruned as
+; usual, and that the ones left are lowered to inline appends and pops on the
+; shadow stack, with the hooks on the slow paths.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+%struct.S = type { i64 }
+
+@__cver_thtable_S = linkonce_odr constant i64 0
+@0 = private unnamed_addr constant { i8* } { i8* bitcast (i64* @__cver_thtable_S to i8*) }
+
+declare i64 @__cver_handle_stack_enter(i8*, i64, i64, i64)
+declare i64 @__cver_handle_stack_exit(i8*, i64)
+declare i64 @__cver_handle_cast(i8*, i64, i64)
+declare void @use(%struct.S*)
+
+; CHECK: @__cver_shadow_stack_top = external thread_local(initialexec) global i64*
+; CHECK: @__cver_shadow_stack_end = external thread_local(initialexec) global i64*
+
+; The object does not escape, so both hooks are pruned, and nothing is
+; lowered.
+; CHECK-LABEL: define void @local()
+define void @local() {
+entry:
+  %s = alloca %struct.S
+  %0 = ptrtoint %struct.S* %s to i64
+  %1 = call i64 @__cver_handle_stack_enter(i8* bitcast ({ i8* }* @0 to i8*), i64 %0, i64 0, i64 8), !cver.stack.inline !0
+  %2 = ptrtoint %struct.S* %s to i64
+  %3 = call i64 @__cver_handle_stack_exit(i8* bitcast ({ i8* }* @0 to i8*), i64 %2), !cver.stack.inline !0
+  ret void
+; CHECK-NOT: @__cver_shadow_stack_top
+; CHECK-NOT: @__cver_handle_stack_enter
+; CHECK-NOT: @__cver_handle_stack_exit
+; CHECK: ret void
+}
+
+; The object escapes to an external function, so the hooks are lowered.
+; CHECK-LABEL: define void @escape()
+define void @escape() {
+entry:
+  %s = alloca %struct.S
+  %enter.addr = ptrtoint %struct.S* %s to i64
+  %0 = call i64 @__cver_handle_stack_enter(i8* bitcast ({ i8* }* @0 to i8*), i64 %enter.addr, i64 0, i64 8), !cver.stack.inline !0
+  call void @use(%struct.S* %s)
+  %exit.addr = ptrtoint %struct.S* %s to i64
+  %1 = call i64 @__cver_handle_stack_exit(i8* bitcast ({ i8* }* @0 to i8*), i64 %exit.addr), !cver.stack.inline !0
+  ret void
+; CHECK: %cver.saved.top = alloca i64*
+; CHECK-NEXT: store i64* null, i64** %cver.saved.top
+; CHECK: [[TOP:%.*]] = load i64** @__cver_shadow_stack_top
+; CHECK-NEXT: [[END:%.*]] = load i64** @__cver_shadow_stack_end
+; CHECK-NEXT: store i64* [[TOP]], i64** %cver.saved.top
+; CHECK-NEXT: [[HAS_ROOM:%.*]] = icmp ult i64* [[TOP]], [[END]]
+; CHECK-NEXT: br i1 [[HAS_ROOM]], label %cver.stack.inline, label %cver.stack.slow
+; CHECK: cver.stack.inline:
+; CHECK-NEXT: store i64 %enter.addr, i64* [[TOP]]
+; CHECK-NEXT: [[SIZE:%.*]] = getelementptr i64* [[TOP]], i32 1
+; CHECK-NEXT: store i64 8, i64* [[SIZE]]
+; CHECK-NEXT: [[TT:%.*]] = getelementptr i64* [[TOP]], i32 2
+; CHECK-NEXT: store i64 ptrtoint (i64* @__cver_thtable_S to i64), i64* [[TT]]
+; CHECK-NEXT: [[NEXT:%.*]] = getelementptr i64* [[TOP]], i32 3
+; CHECK-NEXT: store i64* [[NEXT]], i64** @__cver_shadow_stack_top
+; CHECK-NEXT: br label %cver.stack.cont
+; CHECK: cver.stack.slow:
+; CHECK-NEXT: call i64 @__cver_handle_stack_enter({{.*}}), !cver.stack.lowered
+; CHECK-NEXT: br label %cver.stack.cont
+; CHECK: cver.stack.cont:
+; CHECK-NEXT: call void @use
+; CHECK: [[SAVED:%.*]] = load i64** %cver.saved.top
+; CHECK-NEXT: [[CUR:%.*]] = load i64** @__cver_shadow_stack_top
+; CHECK-NEXT: [[PAST:%.*]] = getelementptr i64* [[SAVED]], i32 3
+; CHECK-NEXT: [[IS_LAST:%.*]] = icmp eq i64* [[CUR]], [[PAST]]
+; CHECK-NEXT: br i1 [[IS_LAST]], label %cver.stack.exit.check, label %cver.stack.exit.slow
+; CHECK: cver.stack.exit.check:
+; CHECK-NEXT: [[ADDR:%.*]] = load i64* [[SAVED]]
+; CHECK-NEXT: [[IS_OWN:%.*]] = icmp eq i64 [[ADDR]], %exit.addr
+; CHECK-NEXT: br i1 [[IS_OWN]], label %cver.stack.exit.inline, label %cver.stack.exit.slow
+; CHECK: cver.stack.exit.inline:
+; CHECK-NEXT: store i64* [[SAVED]], i64** @__cver_shadow_stack_top
+; CHECK-NEXT: br label %cver.stack.exit.cont
+; CHECK: cver.stack.exit.slow:
+; CHECK-NEXT: call i64 @__cver_handle_stack_exit({{.*}}), !cver.stack.lowered
+; CHECK-NEXT: br label %cver.stack.exit.cont
+; CHECK: cver.stack.exit.cont:
+; CHECK-NEXT: ret void
+}
+
+; The slow paths of the hooks lowered already are left alone, as pruning
+; them would leave the inline parts behind.
+; CHECK-LABEL: define void @lowered()
+define void @lowered() {
+entry:
+  %s = alloca %struct.S
+  %0 = ptrtoint %struct.S* %s to i64
+  %1 = call i64 @__cver_handle_stack_enter(i8* bitcast ({ i8* }* @0 to i8*), i64 %0, i64 0, i64 8), !cver.stack.lowered !0
+  ret void
+; CHECK: call i64 @__cver_handle_stack_enter({{.*}}), !cver.stack.lowered
+; CHECK: ret void
+}
+
+!0 = metadata !{}
@@ -0,0 +1,29 @@
+; RUN: opt < %s -cver-type-ids -S | FileCheck %s
+; Check that the THTables of externally visible types are assigned dense type
+; IDs and the cast bitmap, and that the types with internal linkage, whose
+; hashes are not unique across translation units, are left out.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; The hash vectors are { B } for B, { D, B } for D, and { A } and { A, B } for
+; two types named A with internal linkage.
+@__cver_thtable_B = linkonce_odr constant { i64, [0 x { i32, i32, i64 }], i64, [1 x i64], [2 x i32], i64, [2 x i64], i64, [0 x i32], i64, [0 x i64], i64, i64, i8* } { i64 0, [0 x { i32, i32, i64 }] zeroinitializer, i64 1, [1 x i64] [i64 16], [2 x i32] zeroinitializer, i64 1, [2 x i64] [i64 16, i64 0], i64 0, [0 x i32] zeroinitializer, i64 0, [0 x i64] zeroinitializer, i64 0, i64 0, i8* null }
+@__cver_thtable_D = linkonce_odr constant { i64, [0 x { i32, i32, i64 }], i64, [2 x i64], [2 x i32], i64, [4 x i64], i64, [0 x i32], i64, [0 x i64], i64, i64, i8* } { i64 0, [0 x { i32, i32, i64 }] zeroinitializer, i64 2, [2 x i64] [i64 32, i64 17], [2 x i32] zeroinitializer, i64 3, [4 x i64] [i64 16, i64 32, i64 0, i64 0], i64 0, [0 x i32] zeroinitializer, i64 0, [0 x i64] zeroinitializer, i64 0, i64 0, i8* null }
+@0 = private unnamed_addr constant { i64, [0 x { i32, i32, i64 }], i64, [1 x i64], [2 x i32], i64, [2 x i64], i64, [0 x i32], i64, [0 x i64], i64, i64, i8* } { i64 0, [0 x { i32, i32, i64 }] zeroinitializer, i64 1, [1 x i64] [i64 48], [2 x i32] zeroinitializer, i64 1, [2 x i64] [i64 48, i64 0], i64 0, [0 x i32] zeroinitializer, i64 0, [0 x i64] zeroinitializer, i64 0, i64 0, i8* null }
+@1 = private unnamed_addr constant { i64, [0 x { i32, i32, i64 }], i64, [2 x i64], [2 x i32], i64, [4 x i64], i64, [0 x i32], i64, [0 x i64], i64, i64, i8* } { i64 0, [0 x { i32, i32, i64 }] zeroinitializer, i64 2, [2 x i64] [i64 48, i64 16], [2 x i32] zeroinitializer, i64 3, [4 x i64] [i64 16, i64 48, i64 0, i64 0], i64 0, [0 x i32] zeroinitializer, i64 0, [0 x i64] zeroinitializer, i64 0, i64 0, i8* null }
+
+; CHECK: @__cver_thtable_B = {{.*}}, i64 1, i64 ptrtoint ({{.*}}* @cver.cast_bitmap to i64), i8* null }
+; CHECK: @__cver_thtable_D = {{.*}}, i64 2, i64 ptrtoint ({{.*}}* @cver.cast_bitmap to i64), i8* null }
+; CHECK: @0 = {{.*}}, i64 0, i64 0, i8* null }
+; CHECK: @1 = {{.*}}, i64 0, i64 0, i8* null }
+
+; Bits 0 (B to B), 2 (D to B) and 3 (D to D) are set.
+; CHECK: @cver.cast_bitmap = private constant { i64, [1 x i64] } { i64 2, [1 x i64] [i64 13] }
+
+!cver.thtables = !{!0, !1, !2, !3}
+
+!0 = metadata !{{ i64, [0 x { i32, i32, i64 }], i64, [1 x i64], [2 x i32], i64, [2 x i64], i64, [0 x i32], i64, [0 x i64], i64, i64, i8* }* @__cver_thtable_B, i1 true}
+!1 = metadata !{{ i64, [0 x { i32, i32, i64 }], i64, [2 x i64], [2 x i32], i64, [4 x i64], i64, [0 x i32], i64, [0 x i64], i64, i64, i8* }* @__cver_thtable_D, i1 true}
+!2 = metadata !{{ i64, [0 x { i32, i32, i64 }], i64, [1 x i64], [2 x i32], i64, [2 x i64], i64, [0 x i32], i64, [0 x i64], i64, i64, i8* }* @0, i1 false}
+!3 = metadata !{{ i64, [0 x { i32, i32, i64 }], i64, [2 x i64], [2 x i32], i64, [4 x i64], i64, [0 x i32], i64, [0 x i64], i64, i64, i8* }* @1, i1 false}
@@ -53,6 +53,10 @@ class SanitizerArgs {
   bool AsanZeroBaseShadow;
   bool UbsanTrapOnError;
   bool AsanSharedRuntime;
+  bool CverStackNoExit;
+  bool CverStackInline;
+  bool CverNoVptrMap;
+  bool CverTypedNew;
 
  public:
   SanitizerArgs();
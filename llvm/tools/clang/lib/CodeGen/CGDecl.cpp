@@ -500,8 +500,9 @@ namespace {
       llvm::Value *DynamicArgs[] = {
         Address
       };
-      CGF.EmitTypeCastHelper("__cver_handle_stack_exit",
-                             StaticArgs, DynamicArgs);
+      llvm::CallInst *Call = CGF.EmitTypeCastHelper("__cver_handle_stack_exit",
+                                                    StaticArgs, DynamicArgs);
+      CGF.MarkCverStackHookInline(Call);
     }
   };
 }
@@ -836,6 +837,15 @@ static bool shouldUseLifetimeMarkers(CodeGenFunction &CGF, const VarDecl &D,
 }
 
 
+/// MarkCverStackHookInline - Tag a call to __cver_handle_stack_enter or
+/// __cver_handle_stack_exit, to be lowered inline by the CverPruneStack pass
+/// after pruning, with -fsanitize-cver-stack-inline.
+void CodeGenFunction::MarkCverStackHookInline(llvm::CallInst *Call) {
+  if (CGM.getCodeGenOpts().SanitizeCverStackInline)
+    Call->setMetadata("cver.stack.inline",
+                      llvm::MDNode::get(getLLVMContext(), None));
+}
+
 /// EmitAutoVarDecl - Emit code and set up an entry in LocalDeclMap for a
 /// variable declaration with auto, register, or no storage class specifier.
 /// These turn into simple stack objects, or GlobalValues depending on target.
@@ -874,14 +884,20 @@ void CodeGenFunction::EmitAutoVarDecl(const VarDecl &D) {
         llvm::Value *DynamicArgs[] = {
           Address,
           llvm::Constant::getNullValue(Int8PtrTy), // FIXME : numElements
-          llvm::ConstantInt::get(Int8PtrTy, AllocSize)
+          llvm::ConstantInt::get(IntPtrTy, AllocSize)
         };
-        EmitTypeCastHelper("__cver_handle_stack_enter", StaticArgs, DynamicArgs);
-
-        // Cleanup
-        EHStack.pushCleanup<CastVerifierStackExit>(NormalCleanup,
-                                                   Address,
-                                                   TypeTableAddr);
+        MarkCverStackHookInline(EmitTypeCastHelper(
+          "__cver_handle_stack_enter", StaticArgs, DynamicArgs));
+
+        // Cleanup. Without it, the runtime discards the entries of exited
+        // frames by the stack pointer and by the objects overlapping them,
+        // but a later frame may leave a stale entry over its untracked
+        // objects. The entries of frames unwound by exceptions are discarded
+        // in that way as well.
+        if (!CGM.getCodeGenOpts().SanitizeCverStackNoExit)
+          EHStack.pushCleanup<CastVerifierStackExit>(NormalCleanup,
+                                                     Address,
+                                                     TypeTableAddr);
       }
     }
   } // End of SanOpts->CverStack.
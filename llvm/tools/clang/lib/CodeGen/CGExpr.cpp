@@ -487,12 +487,12 @@ CodeGenFunction::EmitTypeCastHelper(StringRef FunctionName,
   return EmitNounwindRuntimeCall(Fn, Args);
 }
 
-llvm::CallInst *CodeGenFunction::EmitTypeCastCheck(QualType DstTy,
-                                                   QualType SrcTy,
-                                                   CXXRecordDecl *RD,
-                                                   SourceLocation Loc,
-                                                   llvm::Value *AfterAddress,
-                                                   llvm::Value *BeforeAddress) {
+llvm::Value *CodeGenFunction::EmitTypeCastCheck(QualType DstTy,
+                                                QualType SrcTy,
+                                                CXXRecordDecl *RD,
+                                                SourceLocation Loc,
+                                                llvm::Value *AfterAddress,
+                                                llvm::Value *BeforeAddress) {
   SmallString<64> _buf1;
   llvm::raw_svector_ostream MangledDstOut(_buf1);
   CGM.getCXXABI().getMangleContext().mangleCXXRTTI(
@@ -515,17 +515,82 @@ llvm::CallInst *CodeGenFunction::EmitTypeCastCheck(QualType DstTy,
     CGM.GetAddrOfTypeTable(RD),
     llvm::ConstantInt::get(Int64Ty, Hash),
   };
-  llvm::Value *DynamicArgs[] = { BeforeAddress, AfterAddress };
 
-  // Leave the metadata on all instrumented instructions with
-  // cver_static_cast, and this metadata will be checked for security
-  // implication analysis in LLVM pass.
-  llvm::CallInst *call = EmitTypeCastHelper("__cver_handle_cast", StaticArgs,
-                                            DynamicArgs);
-  return call;
+  // If the source object is polymorphic, its vptr identifies the allocated
+  // type. Probe the runtime's cache of verified casts inline, and only call
+  // the runtime on a miss (see EmitTypeCheck() for -fsanitize=vptr).
+  CXXRecordDecl *SrcRD = SrcTy->getAsCXXRecordDecl();
+  if (!SrcRD || !SrcRD->hasDefinition() || !SrcRD->isDynamicClass()) {
+    llvm::Value *DynamicArgs[] = { BeforeAddress, AfterAddress };
+
+    // Leave the metadata on all instrumented instructions with
+    // cver_static_cast, and this metadata will be checked for security
+    // implication analysis in LLVM pass.
+    llvm::CallInst *call = EmitTypeCastHelper("__cver_handle_cast", StaticArgs,
+                                              DynamicArgs);
+    return call;
+  }
+
+  llvm::BasicBlock *Cont = createBasicBlock("cver.cont");
+  llvm::BasicBlock *NotNull = createBasicBlock("cver.not.null");
+  llvm::BasicBlock *Miss = createBasicBlock("cver.cache.miss");
+
+  // The runtime does not check null pointers, so don't load the vptr.
+  llvm::BasicBlock *NullBB = Builder.GetInsertBlock();
+  Builder.CreateCondBr(Builder.CreateIsNull(BeforeAddress), Cont, NotNull);
+  EmitBlock(NotNull);
+
+  // Compute hash_16_bytes(TargetHash ^ Adjustment, vptr). The pointer
+  // adjustment is folded into the key, as the validity depends on where
+  // AfterAddress points to within the object.
+  llvm::Value *BeforeInt = Builder.CreatePtrToInt(BeforeAddress, Int64Ty);
+  llvm::Value *AfterInt = Builder.CreatePtrToInt(AfterAddress, Int64Ty);
+  llvm::Value *Low = Builder.CreateXor(llvm::ConstantInt::get(Int64Ty, Hash),
+                                       Builder.CreateSub(AfterInt, BeforeInt));
+  llvm::Type *VPtrTy = llvm::PointerType::get(IntPtrTy, 0);
+  llvm::Value *VPtrAddr = Builder.CreateBitCast(BeforeAddress, VPtrTy);
+  llvm::Value *VPtrVal = Builder.CreateLoad(VPtrAddr);
+  llvm::Value *High = Builder.CreateZExt(VPtrVal, Int64Ty);
+
+  llvm::Value *CacheHash = emitHash16Bytes(Builder, Low, High);
+  CacheHash = Builder.CreateTrunc(CacheHash, IntPtrTy);
+
+  // Look the hash up in the cache. The size should be matched with
+  // VptrTypeCacheSize in the runtime (cver_cache.h).
+  const int CacheSize = 1024;
+  llvm::Type *HashTable = llvm::ArrayType::get(IntPtrTy, CacheSize);
+  llvm::Value *Cache = CGM.CreateRuntimeVariable(HashTable,
+                                                 "__cver_vptr_type_cache");
+  llvm::Value *Slot = Builder.CreateAnd(CacheHash,
+                                        llvm::ConstantInt::get(IntPtrTy,
+                                                               CacheSize-1));
+  llvm::Value *Indices[] = { Builder.getInt32(0), Slot };
+  llvm::Value *CacheVal =
+    Builder.CreateLoad(Builder.CreateInBoundsGEP(Cache, Indices));
+  llvm::BasicBlock *HitBB = Builder.GetInsertBlock();
+  Builder.CreateCondBr(Builder.CreateICmpEQ(CacheVal, CacheHash), Cont, Miss);
+
+  // On a miss, the runtime performs the full check and fills in the cache if
+  // the cast is verified.
+  EmitBlock(Miss);
+  llvm::Value *DynamicArgs[] = { BeforeAddress, AfterAddress, CacheHash };
+  llvm::CallInst *call = EmitTypeCastHelper("__cver_handle_cast_cache_miss",
+                                            StaticArgs, DynamicArgs);
+  llvm::BasicBlock *MissBB = Builder.GetInsertBlock();
+  Builder.CreateBr(Cont);
+  EmitBlock(Cont);
+
+  // Null pointers and cache hits are good casts. The value should be matched
+  // with GOOD_CAST_RET in the runtime.
+  llvm::Constant *Good = llvm::ConstantInt::get(call->getType(), 1);
+  llvm::PHINode *Result = Builder.CreatePHI(call->getType(), 3, "cver.result");
+  Result->addIncoming(Good, NullBB);
+  Result->addIncoming(Good, HitBB);
+  Result->addIncoming(call, MissBB);
+  return Result;
 }
 
-llvm::CallInst *
+llvm::Value *
 CodeGenFunction::EmitTypeCheck(TypeCheckKind TCK, SourceLocation Loc,
                                llvm::Value *Address,
                                llvm::Value *BeforeAddress,
@@ -630,9 +695,7 @@ CodeGenFunction::EmitTypeCheck(TypeCheckKind TCK, SourceLocation Loc,
                                                      Out);
 
     if (!CGM.getSanitizerBlacklist().isBlacklistedType(Out.str())) {
-      llvm::CallInst *call = EmitTypeCastCheck(Ty, SrcTy, RD, Loc,
-                                               Address, BeforeAddress);
-      return call;      
+      return EmitTypeCastCheck(Ty, SrcTy, RD, Loc, Address, BeforeAddress);
     }
   } 
 
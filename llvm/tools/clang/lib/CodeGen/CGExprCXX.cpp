@@ -1237,6 +1237,29 @@ llvm::Value *CodeGenFunction::EmitCXXNewExpr(const CXXNewExpr *E) {
                allocatorType->param_type_end(), E->placement_arg_begin(),
                E->placement_arg_end());
 
+  // The THTable of the allocated type, if the allocation should be recorded in
+  // the CaVer runtime.
+  llvm::Constant *TypeTable = nullptr;
+  bool isTypedNew = false;
+  if (SanOpts->Cver && E->getNumPlacementArgs() == 0) {
+    SmallString<64> MangledName;
+    llvm::raw_svector_ostream MangledNameOut(MangledName);
+    CGM.getCXXABI().getMangleContext().mangleCXXRTTI(
+      allocType.getUnqualifiedType(), MangledNameOut);
+
+    CXXRecordDecl *RD = allocType->getAsCXXRecordDecl();
+    // Polymorphic objects resolvable by their vptrs don't need the metadata,
+    // if the vtable is registered by this TU. Otherwise, the vtable may be
+    // emitted in an uninstrumented TU or DSO, and never be registered.
+    bool isResolvableByVptr =
+      RD && !CGM.getCodeGenOpts().SanitizeCverNoVptrMap &&
+      CGM.getTHTables()->isResolvableByVptr(RD) &&
+      !CGM.getVTables().isVTableExternal(RD);
+    if (RD && !CGM.getSanitizerBlacklist().isBlacklistedAllocType(
+          MangledNameOut.str()) && !isResolvableByVptr)
+      TypeTable = CGM.GetAddrOfTypeTable(RD);
+  }
+
   // Emit the allocation call.  If the allocator is a global placement
   // operator, just "inline" it directly.
   RValue RV;
@@ -1248,34 +1271,44 @@ llvm::Value *CodeGenFunction::EmitCXXNewExpr(const CXXNewExpr *E) {
   } else {
     if (SanOpts->Cver) {
       SanitizerScope SanScope(this, StringRef("cver_new"), allocType);
-      RV = EmitNewDeleteCall(*this, allocator, allocatorType, allocatorArgs);
+      // Allocate and record the type at once through the runtime, if the
+      // user asserts that the program does not replace the global operator
+      // new. It may be replaced in any other TU, so isDefined() is not enough.
+      if (TypeTable && CGM.getCodeGenOpts().SanitizeCverTypedNew &&
+          allocator->isReplaceableGlobalAllocationFunction() &&
+          !allocator->isDefined()) {
+        llvm::Type *ArgTys[] = { SizeTy, Int8PtrTy, SizeTy };
+        llvm::FunctionType *FnTy =
+          llvm::FunctionType::get(Int8PtrTy, ArgTys, false);
+        llvm::Constant *Fn = CGM.CreateRuntimeFunction(
+          FnTy, E->isArray() ? "__cver_new_array_typed" : "__cver_new_typed");
+        llvm::Value *Args[] = {
+          allocSize,
+          llvm::ConstantExpr::getBitCast(TypeTable, Int8PtrTy),
+          numElements ? numElements : llvm::ConstantInt::get(SizeTy, 0)
+        };
+        RV = RValue::get(EmitRuntimeCallOrInvoke(Fn, Args).getInstruction());
+        isTypedNew = true;
+      } else {
+        RV = EmitNewDeleteCall(*this, allocator, allocatorType, allocatorArgs);
+      }
     } else {
       RV = EmitNewDeleteCall(*this, allocator, allocatorType, allocatorArgs);
     }
   }
 
-  SmallString<64> MangledName;
-  llvm::raw_svector_ostream MangledNameOut(MangledName);
-  CGM.getCXXABI().getMangleContext().mangleCXXRTTI(
-    allocType.getUnqualifiedType(), MangledNameOut);
-
-  if (SanOpts->Cver && E->getNumPlacementArgs()== 0
-      && !CGM.getSanitizerBlacklist().isBlacklistedAllocType(
-        MangledNameOut.str())) {
-    CXXRecordDecl *RD = allocType->getAsCXXRecordDecl();
-    if (RD && CGM.GetAddrOfTypeTable(RD)) {
-      llvm::Constant *StaticArgs[] = {
-        CGM.GetAddrOfTypeTable(RD)
-      };
-      assert(RV.isScalar());
-      llvm::Value *DynamicArgs[] = {
-        RV.getScalarVal(),
-        numElements == nullptr ?
-        llvm::Constant::getNullValue(Int8PtrTy) : numElements
-      };
-      // Only passes type information, but does not do casting sanity checks.
-      EmitTypeCastHelper("__cver_handle_new", StaticArgs, DynamicArgs);
-    }
+  if (TypeTable && !isTypedNew) {
+    llvm::Constant *StaticArgs[] = {
+      TypeTable
+    };
+    assert(RV.isScalar());
+    llvm::Value *DynamicArgs[] = {
+      RV.getScalarVal(),
+      numElements == nullptr ?
+      llvm::Constant::getNullValue(Int8PtrTy) : numElements
+    };
+    // Only passes type information, but does not do casting sanity checks.
+    EmitTypeCastHelper("__cver_handle_new", StaticArgs, DynamicArgs);
   } // End of SanOpts->Cver
 
   // Emit a null check on the allocation result if the allocation
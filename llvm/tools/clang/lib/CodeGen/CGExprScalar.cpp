@@ -1317,7 +1317,7 @@ Value *ScalarExprEmitter::VisitCastExpr(CastExpr *CE) {
     assert(DerivedClassDecl && "BaseToDerived arg isn't a C++ object pointer!");
 
     llvm::Value *V = Visit(E);
-    llvm::CallInst *CheckCall = nullptr;
+    llvm::Value *CheckCall = nullptr;
 
     llvm::Value *Derived = nullptr;
     {
@@ -1,9 +1,13 @@
 #include "CodeGenModule.h"
 #include "CGCXXABI.h"
 #include "TargetInfo.h"
+#include "clang/AST/VTableBuilder.h"
 #include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Transforms/Instrumentation.h"
+#include <map>
 
 using namespace clang;
 using namespace CodeGen;
@@ -51,6 +55,140 @@ static bool CollectAllBases(const CXXRecordDecl *BaseRD, void *OpaqueData) {
   return true;
 }
 
+void CodeGenModule::AddCverVTableRecords(const CXXRecordDecl *RD) {
+  if (!getTarget().getCXXABI().isItaniumFamily())
+    return;
+
+  if (!CverRegisteredVTables.insert(RD))
+    return;
+
+  llvm::Constant *TypeTableAddr = GetAddrOfTypeTable(RD);
+  if (!TypeTableAddr)
+    return;
+
+  // Collect the address points with the offsets of their base subobjects,
+  // sorted by the index in the vtable group.
+  std::map<uint64_t, uint64_t> AddressPoints;
+  const VTableLayout &Layout = getItaniumVTableContext().getVTableLayout(RD);
+  for (const auto &AP : Layout.getAddressPoints())
+    AddressPoints[AP.second] = AP.first.getBaseOffset().getQuantity();
+
+  llvm::StructType *RecordTy = getCverVTableRecordTy();
+  llvm::GlobalVariable *VTable = getCXXABI().getAddrOfVTable(RD, CharUnits());
+  for (const auto &AP : AddressPoints) {
+    llvm::Value *Indices[] = {
+      llvm::ConstantInt::get(Int64Ty, 0),
+      llvm::ConstantInt::get(Int64Ty, AP.first)
+    };
+    llvm::Constant *Fields[] = {
+      llvm::ConstantExpr::getBitCast(
+        llvm::ConstantExpr::getInBoundsGetElementPtr(VTable, Indices),
+        Int8PtrTy),
+      TypeTableAddr,
+      llvm::ConstantInt::get(Int64Ty, AP.second)
+    };
+    CverVTableRecords.push_back(llvm::ConstantStruct::get(RecordTy, Fields));
+  }
+}
+
+llvm::StructType *CodeGenModule::getCverVTableRecordTy() {
+  // The layout should be matched with __cver::VTableRecord.
+  return llvm::StructType::get(Int8PtrTy, // The address point.
+                               Int8PtrTy, // The address of TypeTable.
+                               Int64Ty,   // The offset of the base subobject.
+                               nullptr);
+}
+
+llvm::StructType *CodeGenModule::getCverGlobalRecordTy() {
+  // The layout should be matched with __cver::GlobalRecord.
+  return llvm::StructType::get(Int8PtrTy, // The address of the object.
+                               Int64Ty,   // The size of the object.
+                               Int8PtrTy, // The address of TypeTable.
+                               nullptr);
+}
+
+void CodeGenModule::EmitCverRecordRegistration(
+    ArrayRef<llvm::WeakVH> Records, llvm::StructType *RecordTy,
+    StringRef Name, const char *RegisterHook, const char *UnregisterHook) {
+  // The records follow the globals replaced after they are recorded.
+  SmallVector<llvm::Constant *, 16> Elements;
+  for (const auto &Record : Records)
+    if (Record)
+      Elements.push_back(cast<llvm::Constant>(&*Record));
+  if (Elements.empty())
+    return;
+
+  llvm::ArrayType *ArrayTy = llvm::ArrayType::get(RecordTy, Elements.size());
+  llvm::GlobalVariable *Array = new llvm::GlobalVariable(
+    getModule(), ArrayTy, true, llvm::GlobalValue::InternalLinkage,
+    llvm::ConstantArray::get(ArrayTy, Elements), Name);
+
+  llvm::Type *VoidTy = llvm::Type::getVoidTy(getLLVMContext());
+  llvm::Type *ArgTypes[] = {
+    Int8PtrTy, // The address of the records.
+    Int64Ty    // The number of the records.
+  };
+  llvm::FunctionType *FnTy = llvm::FunctionType::get(VoidTy, ArgTypes, false);
+  llvm::Value *Args[] = {
+    llvm::ConstantExpr::getBitCast(Array, Int8PtrTy),
+    llvm::ConstantInt::get(Int64Ty, Elements.size())
+  };
+
+  const char *Hooks[] = { RegisterHook, UnregisterHook };
+  for (unsigned i = 0; i < 2; ++i) {
+    llvm::Constant *FnHook = CreateRuntimeFunction(FnTy, Hooks[i]);
+    llvm::Function *FnWrapper = llvm::Function::Create(
+      llvm::FunctionType::get(VoidTy, false),
+      llvm::GlobalValue::InternalLinkage, Twine(Hooks[i]) + "_wrapper",
+      &getModule());
+    FnWrapper->setUnnamedAddr(true);
+    FnWrapper->addFnAttr(llvm::Attribute::NoInline);
+
+    CGBuilderTy Builder(
+      llvm::BasicBlock::Create(getLLVMContext(), "", FnWrapper));
+    Builder.CreateCall(FnHook, Args);
+    Builder.CreateRetVoid();
+
+    if (i == 0)
+      AddGlobalCtor(FnWrapper, 0);
+    else
+      AddGlobalDtor(FnWrapper, 0);
+  }
+}
+
+void CodeGenModule::EmitCverGlobalRegistration() {
+  EmitCverRecordRegistration(CverGlobalRecords, getCverGlobalRecordTy(),
+                             "__cver_globals", "__cver_register_globals",
+                             "__cver_unregister_globals");
+}
+
+// The address points are unregistered when the module is unloaded, so that a
+// module loaded at the same address does not inherit them.
+void CodeGenModule::EmitCverVTableRegistration() {
+  EmitCverRecordRegistration(CverVTableRecords, getCverVTableRecordTy(),
+                             "__cver_vtables", "__cver_register_vtables",
+                             "__cver_unregister_vtables");
+}
+
+// The runtime locates polymorphic objects by their vptrs (see
+// CodeGenModule::AddCverVTableRecords()). It is enough for RD if every
+// class subobject that a cast can start from has a vptr, i.e., all the bases
+// are dynamic and there is no containment.
+bool CodeGenTHTables::isResolvableByVptr(const CXXRecordDecl *RD) {
+  if (!CGM.getTarget().getCXXABI().isItaniumFamily() || !RD->isDynamicClass())
+    return false;
+
+  BaseVec Bases;
+  RD->forallBases(CollectAllBases, (void*)&Bases);
+  for (auto &BaseRD: Bases)
+    if (!BaseRD->isDynamicClass())
+      return false;
+
+  SmallVector<ContainInterval, 16> Intervals;
+  collectContainIntervals(RD, 0, Intervals);
+  return Intervals.empty();
+}
+
 // Recursively search through the given QT, and return the element's QualType if
 // it is CXX class. Return Null otherwise.
 static QualType getElemQualTypeOrNull(const QualType QT, bool &isCompoundElem) {
@@ -77,9 +215,16 @@ TH_HASH CodeGenTHTables::hash_value_with_uniqueness(
   return (hash_value(S) << 1 | isSameLayout);
 }
 
+// Offsets and sizes in THTables are 32-bit, so containments beyond this are not
+// recorded.
+static const uint64_t MaxTHTableOffset = UINT32_MAX;
+
+// HashVector holds the hashes of RD and its bases contiguously, and
+// BaseOffsets holds their 32-bit offsets in the same order.
 bool CodeGenTHTables::constructHashVector(
   const CXXRecordDecl *RD,
   SmallVector<llvm::Constant *, 64> &HashVector,
+  SmallVector<llvm::Constant *, 64> &BaseOffsets,
   SmallVector<llvm::SmallString<256>, 64> &BaseNames) {
   // Collect all base RD recursively.
   BaseVec Bases;
@@ -91,7 +236,7 @@ bool CodeGenTHTables::constructHashVector(
 
   TH_HASH OwnHash = hash_value_with_uniqueness(MangledTypeName, false);
   HashVector.push_back(llvm::ConstantInt::get(CGM.Int64Ty, OwnHash));
-  HashVector.push_back(llvm::Constant::getNullValue(CGM.Int64Ty));
+  BaseOffsets.push_back(llvm::Constant::getNullValue(CGM.Int32Ty));
   
   CVER_DEBUG("\t self: [ " << MangledTypeName << "] : "
              << (long)OwnHash << ":" << (void*)RD << "\n");
@@ -113,7 +258,7 @@ bool CodeGenTHTables::constructHashVector(
 
     TH_HASH BaseHash = hash_value_with_uniqueness(BaseName, isSameLayout);
     HashVector.push_back(llvm::ConstantInt::get(CGM.Int64Ty, BaseHash));
-    HashVector.push_back(llvm::ConstantInt::get(CGM.Int64Ty, BaseOffset));
+    BaseOffsets.push_back(llvm::ConstantInt::get(CGM.Int32Ty, BaseOffset));
     BaseNames.push_back(BaseName);
 
     CVER_DEBUG( "\t Base: [ " << BaseName << "] : "
@@ -123,6 +268,39 @@ bool CodeGenTHTables::constructHashVector(
   return true;
 }
 
+// Build an open-addressed set of the hashes in HashVector (without
+// isSameLayout bits), so that the runtime can test the membership of the target
+// hash with a couple of probes. The probing should be matched with
+// IsInBaseSet() in the runtime.
+bool CodeGenTHTables::constructBaseSet(
+  const SmallVector<llvm::Constant *, 64> &HashVector,
+  SmallVector<llvm::Constant *, 64> &BaseSet) {
+  assert(HashVector.size() > 0);
+  uint64_t NumBases = HashVector.size();
+
+  // Keep the load factor under 0.5, so there always exists an empty slot.
+  uint64_t NumSlots = llvm::NextPowerOf2(NumBases * 2 - 1);
+  uint64_t Mask = NumSlots - 1;
+  SmallVector<TH_HASH, 64> Slots(NumSlots, 0);
+
+  for (uint64_t i = 0; i < NumBases; i++) {
+    TH_HASH Hash =
+      cast<llvm::ConstantInt>(HashVector[i])->getZExtValue() & ~1ULL;
+    if (!Hash)
+      continue;
+
+    uint64_t Slot = (Hash >> 1) & Mask;
+    while (Slots[Slot] && Slots[Slot] != Hash)
+      Slot = (Slot + 1) & Mask;
+    Slots[Slot] = Hash;
+  }
+
+  BaseSet.push_back(llvm::ConstantInt::get(CGM.Int64Ty, Mask));
+  for (TH_HASH Hash: Slots)
+    BaseSet.push_back(llvm::ConstantInt::get(CGM.Int64Ty, Hash));
+  return true;
+}
+
 bool CodeGenTHTables::constructContainVector(
   const CXXRecordDecl *RD, uint64_t Offset,
   SmallVector<llvm::Constant *, 64> &ContainVec,
@@ -164,10 +342,16 @@ bool CodeGenTHTables::constructContainVector(
     
     assert(fieldOffsetBits % 8 == 0 && Context.getType(QT) % 8 == 0);
 
-    ContainVec.push_back(llvm::ConstantInt::get(CGM.Int64Ty,
+    if (Offset + fieldOffset + fieldSize > MaxTHTableOffset)
+      continue;
+
+    ContainVec.push_back(llvm::ConstantInt::get(CGM.Int32Ty,
                                                 Offset + fieldOffset));
-    ContainVec.push_back(llvm::ConstantInt::get(CGM.Int64Ty, fieldSize));
-    ContainVec.push_back(CGM.GetAddrOfTypeTable(ElemRD));
+    ContainVec.push_back(llvm::ConstantInt::get(CGM.Int32Ty, fieldSize));
+    llvm::Constant *ElemTHTable = CGM.GetAddrOfTypeTable(ElemRD);
+    ContainVec.push_back(
+      ElemTHTable ? llvm::ConstantExpr::getPtrToInt(ElemTHTable, CGM.Int64Ty)
+                  : llvm::Constant::getNullValue(CGM.Int64Ty));
 
     SmallString<256> ContainName;
     GetMangledName(ElemRD, ContainName);
@@ -214,6 +398,159 @@ bool CodeGenTHTables::constructContainVector(
   return true;
 }
 
+// Arrays of classes with more elements than this are not expanded per element
+// in the flattened containment vector. Instead, all the nested containments of
+// the element type are assumed to span the whole array.
+static const uint64_t MaxFlattenedArrayElements = 256;
+
+// The limit on the intervals of a THTable. Nested arrays multiply the
+// intervals of their elements, so an array whose expansion would exceed the
+// limit is summarized as above, regardless of its number of elements.
+static const uint64_t MaxContainIntervals = 4096;
+
+// Collect all containments of RD, including the containments of containments
+// and of (non-virtual) bases, with their offsets from the beginning of RD.
+void CodeGenTHTables::collectContainIntervals(
+  const CXXRecordDecl *RD, uint64_t Offset,
+  SmallVectorImpl<ContainInterval> &Intervals) {
+  const ASTRecordLayout &Layout = Context.getASTRecordLayout(RD);
+
+  for (const auto *FD: RD->fields()) {
+    // Ignore an anonymous field, as constructContainVector() does.
+    if (!FD->getDeclName())
+      continue;
+
+    QualType QT = FD->getType().getUnqualifiedType();
+    bool isCompoundElem = false;
+    QualType ElemQT = getElemQualTypeOrNull(QT, isCompoundElem);
+    if (!isCompoundElem)
+      continue;
+
+    const CXXRecordDecl *ElemRD = ElemQT->getAsCXXRecordDecl();
+    if (!ElemRD || !ElemRD->hasDefinition())
+      continue;
+
+    uint64_t FieldOffset =
+      Offset + Layout.getFieldOffset(FD->getFieldIndex()) / 8;
+    uint64_t FieldSize = Context.getTypeSizeInChars(QT).getQuantity();
+    uint64_t ElemSize = Context.getTypeSizeInChars(ElemQT).getQuantity();
+    if (FieldOffset + FieldSize > MaxTHTableOffset)
+      continue;
+
+    // The whole field (or array) is of ElemRD, as in ContainVec.
+    ContainInterval Field = { FieldOffset, FieldSize, ElemRD };
+    Intervals.push_back(Field);
+
+    if (!ElemSize)
+      continue;
+
+    SmallVector<ContainInterval, 16> Nested;
+    collectContainIntervals(ElemRD, 0, Nested);
+    uint64_t NumElements = FieldSize / ElemSize;
+    if (NumElements <= MaxFlattenedArrayElements &&
+        Intervals.size() + NumElements * Nested.size() <= MaxContainIntervals) {
+      for (uint64_t i = 0; i < NumElements; i++) {
+        for (auto &I: Nested) {
+          ContainInterval Element = { FieldOffset + i * ElemSize + I.Offset,
+                                      I.Size, I.RD };
+          Intervals.push_back(Element);
+        }
+      }
+    } else {
+      llvm::SmallPtrSet<const CXXRecordDecl *, 16> Summarized;
+      for (auto &I: Nested) {
+        if (!Summarized.insert(I.RD))
+          continue;
+        ContainInterval Summary = { FieldOffset, FieldSize, I.RD };
+        Intervals.push_back(Summary);
+      }
+    }
+  }
+
+  for (const auto &I : RD->bases()) {
+    if (I.isVirtual())
+      continue;
+    const CXXRecordDecl *Base = I.getType()->getAsCXXRecordDecl();
+    collectContainIntervals(
+      Base, Offset + Layout.getBaseClassOffset(Base).getQuantity(), Intervals);
+  }
+}
+
+// Flatten all nested containments of RD into disjoint segments sorted by
+// offset. Each segment is 32-bit (offset, size, index, count), where
+// FlatHashes[index, index+count) is the sorted list of the hashes (without
+// isSameLayout bits) of all types reachable at the segment. The runtime
+// binary-searches the segment, and then the hash.
+bool CodeGenTHTables::constructFlatContainVector(
+  const CXXRecordDecl *RD,
+  SmallVector<llvm::Constant *, 64> &FlatVec,
+  SmallVector<llvm::Constant *, 64> &FlatHashes) {
+  SmallVector<ContainInterval, 16> Intervals;
+  collectContainIntervals(RD, 0, Intervals);
+
+  // The hashes of a type and all of its bases.
+  llvm::DenseMap<const CXXRecordDecl *, SmallVector<TH_HASH, 8> > TypeHashes;
+  for (auto &I: Intervals) {
+    SmallVector<TH_HASH, 8> &Hashes = TypeHashes[I.RD];
+    if (!Hashes.empty())
+      continue;
+
+    BaseVec Bases;
+    I.RD->forallBases(CollectAllBases, (void*)&Bases);
+    Bases.push_back(I.RD);
+    for (auto &BaseRD: Bases) {
+      SmallString<256> BaseName;
+      GetMangledName(BaseRD, BaseName);
+      Hashes.push_back(hash_value_with_uniqueness(BaseName, false));
+    }
+  }
+
+  SmallVector<uint64_t, 32> Bounds;
+  for (auto &I: Intervals) {
+    Bounds.push_back(I.Offset);
+    Bounds.push_back(I.Offset + I.Size);
+  }
+  std::sort(Bounds.begin(), Bounds.end());
+  Bounds.erase(std::unique(Bounds.begin(), Bounds.end()), Bounds.end());
+
+  SmallVector<TH_HASH, 16> PrevHashes;
+  uint64_t NumHashes = 0;
+  for (unsigned i = 0; i + 1 < Bounds.size(); i++) {
+    uint64_t Begin = Bounds[i], End = Bounds[i + 1];
+
+    SmallVector<TH_HASH, 16> SegHashes;
+    for (auto &I: Intervals)
+      if (I.Offset <= Begin && End <= I.Offset + I.Size)
+        SegHashes.append(TypeHashes[I.RD].begin(), TypeHashes[I.RD].end());
+    if (SegHashes.empty()) {
+      PrevHashes.clear();
+      continue;
+    }
+    std::sort(SegHashes.begin(), SegHashes.end());
+    SegHashes.erase(std::unique(SegHashes.begin(), SegHashes.end()),
+                    SegHashes.end());
+
+    // Extend the previous segment if it is adjacent and has the same hashes.
+    if (!FlatVec.empty() && SegHashes == PrevHashes) {
+      uint64_t PrevOffset =
+        cast<llvm::ConstantInt>(FlatVec[FlatVec.size() - 4])->getZExtValue();
+      FlatVec[FlatVec.size() - 3] =
+        llvm::ConstantInt::get(CGM.Int32Ty, End - PrevOffset);
+      continue;
+    }
+
+    FlatVec.push_back(llvm::ConstantInt::get(CGM.Int32Ty, Begin));
+    FlatVec.push_back(llvm::ConstantInt::get(CGM.Int32Ty, End - Begin));
+    FlatVec.push_back(llvm::ConstantInt::get(CGM.Int32Ty, NumHashes));
+    FlatVec.push_back(llvm::ConstantInt::get(CGM.Int32Ty, SegHashes.size()));
+    for (TH_HASH Hash: SegHashes)
+      FlatHashes.push_back(llvm::ConstantInt::get(CGM.Int64Ty, Hash));
+    NumHashes += SegHashes.size();
+    PrevHashes = SegHashes;
+  }
+  return true;
+}
+
 void CodeGenTHTables::dumpDowncastInfo(StringRef SrcTypeName,
                                        llvm::Value *BeforeAddress,
                                        StringRef DstTypeName,
@@ -335,45 +672,127 @@ llvm::GlobalVariable *CodeGenTHTables::GenerateTypeHierarchy(
   SmallVector<SmallString<256>, 64> ContainNames;
   
   SmallVector<llvm::Constant *, 64> HashVector;
+  SmallVector<llvm::Constant *, 64> BaseOffsets;
   SmallVector<llvm::Constant *, 64> ContainVec;
 
-  constructHashVector(RD, HashVector, BaseNames);
+  SmallVector<llvm::Constant *, 64> BaseSet;
+  SmallVector<llvm::Constant *, 64> FlatContainVec;
+  SmallVector<llvm::Constant *, 64> FlatHashes;
+
+  constructHashVector(RD, HashVector, BaseOffsets, BaseNames);
+  constructBaseSet(HashVector, BaseSet);
   constructContainVector(RD, 0, ContainVec, ContainNames);
+  constructFlatContainVector(RD, FlatContainVec, FlatHashes);
 
   // --------------------------------------------
   // Create the global variable; see getAddrOfVTable()
-  llvm::ArrayType *ContainVecTy = llvm::ArrayType::get(CGM.Int64Ty,
-                                                       ContainVec.size());
-
+  assert(ContainVec.size() % 3 == 0);
+  assert(HashVector.size() == BaseOffsets.size());
+  assert(FlatContainVec.size() % 4 == 0);
+
+  // Each containment is packed into { i32 offset, i32 size, i64 THTable }.
+  llvm::StructType *ContainElemTy =
+    llvm::StructType::get(CGM.Int32Ty, CGM.Int32Ty, CGM.Int64Ty, nullptr);
+  SmallVector<llvm::Constant *, 64> ContainElems;
+  for (unsigned i = 0; i < ContainVec.size(); i += 3)
+    ContainElems.push_back(llvm::ConstantStruct::get(
+      ContainElemTy, makeArrayRef(ContainVec).slice(i, 3)));
+
+  // Pad 32-bit offsets to keep the following 64-bit fields aligned.
+  uint64_t NumBases = HashVector.size();
+  if (BaseOffsets.size() % 2)
+    BaseOffsets.push_back(llvm::Constant::getNullValue(CGM.Int32Ty));
+
+  llvm::ArrayType *ContainVecTy = llvm::ArrayType::get(ContainElemTy,
+                                                       ContainElems.size());
   llvm::ArrayType *HashVectorType = llvm::ArrayType::get(CGM.Int64Ty,
                                                          HashVector.size());
-  assert(ContainVec.size() % 3 == 0);
-  assert(HashVector.size() % 2 == 0);
-
-  llvm::Constant *TypeTableStruct[] = {
-    // Containment Vector
-    llvm::ConstantInt::get(CGM.Int64Ty, ContainVec.size()/3),
-    llvm::ConstantArray::get(ContainVecTy, ContainVec),
-    // Hash Vector
-    llvm::ConstantInt::get(CGM.Int64Ty, HashVector.size()/2),
-    llvm::ConstantArray::get(HashVectorType, HashVector),
-    // Type name
-    llvm::ConstantDataArray::getString(CGM.getLLVMContext(), TypeName.str())
-  };
+  llvm::ArrayType *BaseOffsetsType = llvm::ArrayType::get(CGM.Int32Ty,
+                                                          BaseOffsets.size());
+  llvm::ArrayType *BaseSetType = llvm::ArrayType::get(CGM.Int64Ty,
+                                                      BaseSet.size() - 1);
+  llvm::ArrayType *FlatContainVecTy = llvm::ArrayType::get(
+    CGM.Int32Ty, FlatContainVec.size());
+  llvm::ArrayType *FlatHashesTy = llvm::ArrayType::get(CGM.Int64Ty,
+                                                       FlatHashes.size());
+
+  // The type name is only used for reports, so it is kept out of the table
+  // in a (mergeable) string section.
+  llvm::Constant *TypeNameStr = llvm::ConstantExpr::getBitCast(
+    CGM.GetAddrOfConstantCString(TypeName.str()), CGM.Int8PtrTy);
+
+  namespace THT = llvm::CverTHTable;
+  llvm::Constant *TypeTableStruct[THT::NumFields];
+  // Containment Vector
+  TypeTableStruct[THT::NumContainments] =
+    llvm::ConstantInt::get(CGM.Int64Ty, ContainElems.size());
+  TypeTableStruct[THT::ContainVector] =
+    llvm::ConstantArray::get(ContainVecTy, ContainElems);
+  // Hash Vector
+  TypeTableStruct[THT::NumBases] =
+    llvm::ConstantInt::get(CGM.Int64Ty, NumBases);
+  TypeTableStruct[THT::HashVector] =
+    llvm::ConstantArray::get(HashVectorType, HashVector);
+  TypeTableStruct[THT::BaseOffsets] =
+    llvm::ConstantArray::get(BaseOffsetsType, BaseOffsets);
+  // Base Set
+  TypeTableStruct[THT::BaseSetMask] = BaseSet[0];
+  TypeTableStruct[THT::BaseSetSlots] =
+    llvm::ConstantArray::get(BaseSetType, makeArrayRef(BaseSet).slice(1));
+  // Flattened Containment Vector
+  TypeTableStruct[THT::NumFlatSegments] =
+    llvm::ConstantInt::get(CGM.Int64Ty, FlatContainVec.size()/4);
+  TypeTableStruct[THT::FlatContainVector] =
+    llvm::ConstantArray::get(FlatContainVecTy, FlatContainVec);
+  TypeTableStruct[THT::NumFlatHashes] =
+    llvm::ConstantInt::get(CGM.Int64Ty, FlatHashes.size());
+  TypeTableStruct[THT::FlatHashes] =
+    llvm::ConstantArray::get(FlatHashesTy, FlatHashes);
+  // Type ID and cast bitmap, assigned by CverTypeIds pass under LTO.
+  TypeTableStruct[THT::TypeId] = llvm::ConstantInt::get(CGM.Int64Ty, 0);
+  TypeTableStruct[THT::CastBitmap] = llvm::ConstantInt::get(CGM.Int64Ty, 0);
+  // Type name
+  TypeTableStruct[THT::TypeName] = TypeNameStr;
   llvm::Constant *THTable = llvm::ConstantStruct::getAnon(TypeTableStruct);
 
-  auto *GV = new llvm::GlobalVariable(
+  SmallString<256> MangledTypeName;
+  GetMangledName(RD, MangledTypeName);
+
+  // Externally visible types have exactly one THTable per link, keyed on the
+  // mangled name, so that the runtime can compare THTables by pointers. Types
+  // with internal linkage may share the mangled name across translation units,
+  // so they keep a private THTable.
+  llvm::GlobalVariable *GV;
+  if (RD->isExternallyVisible()) {
+    SmallString<256> THTableName("__cver_thtable_");
+    THTableName += MangledTypeName;
+    GV = new llvm::GlobalVariable(
+      CGM.getModule(), THTable->getType(),
+      /*isConstant=*/true, llvm::GlobalVariable::LinkOnceODRLinkage, THTable,
+      THTableName.str());
+    if (!CGM.getTarget().getTriple().isOSBinFormatMachO())
+      GV->setComdat(CGM.getModule().getOrInsertComdat(GV->getName()));
+  } else {
+    GV = new llvm::GlobalVariable(
       CGM.getModule(), THTable->getType(),
       /*isConstant=*/true, llvm::GlobalVariable::PrivateLinkage, THTable);
-  GV->setUnnamedAddr(true);
+    GV->setUnnamedAddr(true);
+  }
 
   CGM.setTHTableInMap(RD, GV);
 
-  SmallString<256> MangledTypeName;
-  GetMangledName(RD, MangledTypeName);
+  // Let the link-time pass find all THTables of the program, and which of them
+  // are unique by their mangled names.
+  llvm::Value *THTableMD[] = {
+    GV, llvm::ConstantInt::get(llvm::Type::getInt1Ty(CGM.getLLVMContext()),
+                               RD->isExternallyVisible())
+  };
+  CGM.getModule().getOrInsertNamedMetadata("cver.thtables")->addOperand(
+    llvm::MDNode::get(CGM.getLLVMContext(), THTableMD));
+
   if (OptCverLog)
     dumpTHTableInfo(MangledTypeName, TypeName,
-                    ContainVec.size()/3, HashVector.size()/2-1,
+                    ContainElems.size(), NumBases-1,
                     BaseNames, ContainNames);
 
   if (OptCverDebug)
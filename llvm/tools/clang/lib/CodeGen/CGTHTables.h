@@ -28,16 +28,32 @@ public:
   static TH_HASH hash_value_with_uniqueness(StringRef S, bool isSameLayout);
   void dumpDowncastInfo(StringRef SrcTypeName, llvm::Value *BeforeAddress,
                         StringRef DstTypeName, llvm::Value *AfterAddress);
+  bool isResolvableByVptr(const CXXRecordDecl *RD);
 private:
+  // A (possibly nested) containment of RD at [Offset, Offset+Size).
+  struct ContainInterval {
+    uint64_t Offset;
+    uint64_t Size;
+    const CXXRecordDecl *RD;
+  };
+
   bool OptCverDebug;
   bool OptCverLog;
   bool constructHashVector(const CXXRecordDecl *RD,
                            SmallVector<llvm::Constant *, 64> &HashVector,
+                           SmallVector<llvm::Constant *, 64> &BaseOffsets,
                            SmallVector<SmallString<256>, 64> &BaseNames);
+  bool constructBaseSet(const SmallVector<llvm::Constant *, 64> &HashVector,
+                        SmallVector<llvm::Constant *, 64> &BaseSet);
   bool constructContainVector(const CXXRecordDecl *RD,
                               uint64_t Offset,
                               SmallVector<llvm::Constant *, 64> &ContainVec,
                               SmallVector<SmallString<256>, 64> &ContainNames);
+  void collectContainIntervals(const CXXRecordDecl *RD, uint64_t Offset,
+                               SmallVectorImpl<ContainInterval> &Intervals);
+  bool constructFlatContainVector(const CXXRecordDecl *RD,
+                                  SmallVector<llvm::Constant *, 64> &FlatVec,
+                                  SmallVector<llvm::Constant *, 64> &FlatHashes);
   void dumpClassLayout(const CXXRecordDecl *RD);
   void dumpTHTableInfo(StringRef MangledName, StringRef Name,
                        int numComposites, int numBases,
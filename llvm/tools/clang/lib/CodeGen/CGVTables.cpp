@@ -704,6 +704,9 @@ CodeGenVTables::GenerateClassData(const CXXRecordDecl *RD) {
     CGM.getCXXABI().emitVirtualInheritanceTables(RD);
 
   CGM.getCXXABI().emitVTableDefinitions(*this, RD);
+
+  if (CGM.getLangOpts().Sanitize.Cver)
+    CGM.AddCverVTableRecords(RD);
 }
 
 /// At this point in the translation unit, does it appear that can we
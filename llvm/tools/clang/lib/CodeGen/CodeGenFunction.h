@@ -1720,15 +1720,22 @@ public:
   /// calls to EmitTypeCheck can be skipped.
   bool sanitizePerformTypeCheck() const;
 
-  llvm::CallInst *EmitTypeCastCheck(QualType DstTy, QualType SrcTy,
-                                    CXXRecordDecl *RD,
-                                    SourceLocation Loc,
-                                    llvm::Value *AfterAddress,
-                                    llvm::Value *BeforeAddress);
+  /// \brief Emit a CastVerifier check that \p AfterAddress, cast from
+  /// \p BeforeAddress, points to an object of type \p DstTy. Returns the
+  /// result of the check, which is available once the check is done: the
+  /// value returned by the runtime, or GOOD_CAST_RET for the null pointers
+  /// and the casts found in the inline cache.
+  llvm::Value *EmitTypeCastCheck(QualType DstTy, QualType SrcTy,
+                                 CXXRecordDecl *RD,
+                                 SourceLocation Loc,
+                                 llvm::Value *AfterAddress,
+                                 llvm::Value *BeforeAddress);
   
   /// \brief Emit a check that \p V is the address of storage of the
-  /// appropriate size and alignment for an object of type \p Type.
-  llvm::CallInst* EmitTypeCheck(
+  /// appropriate size and alignment for an object of type \p Type. Returns
+  /// the result of the CastVerifier check (see EmitTypeCastCheck()), or null
+  /// if there is none.
+  llvm::Value *EmitTypeCheck(
     TypeCheckKind TCK, SourceLocation Loc,
     llvm::Value *Address, llvm::Value *BeforeAddress,
     QualType Type, QualType SrcType,
@@ -2568,6 +2575,10 @@ public:
                                       ArrayRef<llvm::Constant *> StaticArgs,
                                       ArrayRef<llvm::Value *> DynamicArgs);
 
+  /// \brief Tag a CastVerifier stack hook to be lowered inline after pruning,
+  /// with -fsanitize-cver-stack-inline.
+  void MarkCverStackHookInline(llvm::CallInst *Call);
+
   /// \brief Create a basic block that will call the trap intrinsic, and emit a
   /// conditional branch to it, for the -ftrapv checks.
   void EmitTrapCheck(llvm::Value *Checked);
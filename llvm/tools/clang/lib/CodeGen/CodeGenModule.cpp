@@ -331,6 +331,8 @@ void CodeGenModule::Release() {
   EmitCXXGlobalInitFunc();
   EmitCXXGlobalDtorFunc();
   EmitCXXThreadLocalInitFunc();
+  EmitCverVTableRegistration();
+  EmitCverGlobalRegistration();
   if (ObjCRuntime)
     if (llvm::Function *ObjCInitFunction = ObjCRuntime->ModuleInitFunction())
       AddGlobalCtor(ObjCInitFunction);
@@ -1953,8 +1955,7 @@ void CodeGenModule::EmitGlobalVarDefinition(const VarDecl *D) {
   if (NeedsGlobalCtor || NeedsGlobalDtor)
     EmitCXXGlobalVarDeclInitFunc(D, GV, NeedsGlobalCtor);
 
-  CodeGenFunction *CGF = new CodeGenFunction(*this);  
-  if (CGF && CGF->SanOpts->Cver) {
+  if (LangOpts.Sanitize.Cver) {
     QualType Ty = D->getType();
     CXXRecordDecl *RD = Ty->getAsCXXRecordDecl();
     uint64_t AllocSize = getContext().getTypeSizeInChars(Ty).getQuantity();
@@ -1967,53 +1968,14 @@ void CodeGenModule::EmitGlobalVarDefinition(const VarDecl *D) {
     if (GV && AllocSize > 0 && RD && RD->hasDefinition()
         && !RD->isAnonymousStructOrUnion() && GetAddrOfTypeTable(RD)
         && !getSanitizerBlacklist().isBlacklistedType(Out.str())) {
-      llvm::Constant *TypeTableAddr = GetAddrOfTypeTable(RD);
-      llvm::Type *VoidTy = llvm::Type::getVoidTy(getLLVMContext());
-      
-      /////////////////////////////////////////////////      
-      // Create the call reference to __cver_handle_global_var.
-      // http://llvm.org/docs/doxygen/html/classllvm_1_1Function.html
-      SmallVector<llvm::Type*, 8> ArgTypes;
-      ArgTypes.push_back(VoidPtrTy); // The base address of object.
-      ArgTypes.push_back(TypeTableAddr->getType()); // The address of TypeTable.
-      ArgTypes.push_back(Int64Ty); // Allocation Size.
-      
-      llvm::FunctionType *FnTypeCverHandleGlobalVar =
-        llvm::FunctionType::get(VoidTy, ArgTypes, false);
-      
-      llvm::AttrBuilder B;
-      B.addAttribute(llvm::Attribute::UWTable);
-      llvm::Constant *FnCverHandleGlobalVar = CreateRuntimeFunction(
-        FnTypeCverHandleGlobalVar, "__cver_handle_global_var",
-        llvm::AttributeSet::get(getLLVMContext(),
-                                llvm::AttributeSet::FunctionIndex, B));
-
-      /////////////////////////////////////////////////
-      // Create Wrapper function
-      // void __cver_handle_global_wrapper(uptr Address)
-
-      llvm::Function *FnCverHandleGlobalWrapper = llvm::Function::Create(
-        llvm::FunctionType::get(VoidTy, false),
-        llvm::GlobalValue::InternalLinkage,
-        "__cver_handle_global_wrapper", &getModule());
-      
-      FnCverHandleGlobalWrapper->setUnnamedAddr(true);
-      FnCverHandleGlobalWrapper->addFnAttr(llvm::Attribute::NoInline);
-
-      // Construct the body of __cver_handle_global_wrapper().
-      CGBuilderTy Builder(
-        llvm::BasicBlock::Create(
-          getLLVMContext(), "", FnCverHandleGlobalWrapper));
-
-      LValue LV = CGF->MakeAddrLValue(GV, getContext().getPointerType(Ty));
-      Builder.CreateCall3(FnCverHandleGlobalVar,
-                          Builder.CreateBitCast(LV.getAddress(), VoidPtrTy),
-                          TypeTableAddr,
-                          llvm::ConstantInt::get(Int64Ty, AllocSize));
-      Builder.CreateRetVoid();
-
-      // Push the wrappaer function to global ctors.
-      AddGlobalCtor(FnCverHandleGlobalWrapper, 0);
+      // Registered in bulk by EmitCverGlobalRegistration().
+      llvm::Constant *Fields[] = {
+        llvm::ConstantExpr::getBitCast(GV, Int8PtrTy),
+        llvm::ConstantInt::get(Int64Ty, AllocSize),
+        GetAddrOfTypeTable(RD)
+      };
+      CverGlobalRecords.push_back(
+        llvm::ConstantStruct::get(getCverGlobalRecordTy(), Fields));
     }
   } // End of SanOpts->Cver.
   
@@ -381,6 +381,17 @@ class CodeGenModule : public CodeGenTypeCache {
   /// Map used to get unique type hierarchy table.
   llvm::DenseMap<const CXXRecordDecl *, llvm::GlobalVariable *> THTableMap;
 
+  /// Classes whose vtable address points are registered to the CaVer runtime.
+  llvm::SmallPtrSet<const CXXRecordDecl *, 16> CverRegisteredVTables;
+
+  /// The (address, size, THTable) records of the global objects to register
+  /// to the CaVer runtime.
+  std::vector<llvm::WeakVH> CverGlobalRecords;
+
+  /// The (address point, THTable, base offset) records of the vtables to
+  /// register to the CaVer runtime.
+  std::vector<llvm::WeakVH> CverVTableRecords;
+
   /// Map used to track internal linkage functions declared within
   /// extern "C" regions.
   typedef llvm::MapVector<IdentifierInfo *,
@@ -972,6 +983,32 @@ public:
 
   void EmitTHTable(CXXRecordDecl *Class, bool DefinitionRequired);
 
+  /// Record the vtable address points of the class with its THTable, so
+  /// that the CaVer runtime can locate polymorphic objects by their vptrs.
+  void AddCverVTableRecords(const CXXRecordDecl *RD);
+
+  /// The type of the records in CverVTableRecords.
+  llvm::StructType *getCverVTableRecordTy();
+
+  /// The type of the records in CverGlobalRecords.
+  llvm::StructType *getCverGlobalRecordTy();
+
+  /// Register the records to the CaVer runtime at once by RegisterHook, in
+  /// an array named Name, and unregister them by UnregisterHook when the
+  /// module is unloaded.
+  void EmitCverRecordRegistration(ArrayRef<llvm::WeakVH> Records,
+                                  llvm::StructType *RecordTy, StringRef Name,
+                                  const char *RegisterHook,
+                                  const char *UnregisterHook);
+
+  /// Register the global objects of the module to the CaVer runtime at once,
+  /// and unregister them when the module is unloaded.
+  void EmitCverGlobalRegistration();
+
+  /// Register the vtable address points of the module to the CaVer runtime
+  /// at once, and unregister them when the module is unloaded.
+  void EmitCverVTableRegistration();
+
   /// Emit the RTTI descriptors for the builtin types.
   void EmitFundamentalRTTIDescriptors();
 
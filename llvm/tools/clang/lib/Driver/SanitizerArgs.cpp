@@ -28,6 +28,10 @@ void SanitizerArgs::clear() {
   AsanZeroBaseShadow = false;
   UbsanTrapOnError = false;
   AsanSharedRuntime = false;
+  CverStackNoExit = false;
+  CverStackInline = false;
+  CverNoVptrMap = false;
+  CverTypedNew = false;
 }
 
 SanitizerArgs::SanitizerArgs() {
@@ -161,6 +165,30 @@ SanitizerArgs::SanitizerArgs(const ToolChain &TC,
     }
   }
 
+  // Parse -f[no-]sanitize-cver-stack-no-exit options.
+  if (needsCverRt())
+    CverStackNoExit =
+        Args.hasFlag(options::OPT_fsanitize_cver_stack_no_exit,
+                     options::OPT_fno_sanitize_cver_stack_no_exit, false);
+
+  // Parse -f[no-]sanitize-cver-stack-inline options.
+  if (needsCverRt())
+    CverStackInline =
+        Args.hasFlag(options::OPT_fsanitize_cver_stack_inline,
+                     options::OPT_fno_sanitize_cver_stack_inline, false);
+
+  // Parse -f[no-]sanitize-cver-no-vptr-map options.
+  if (needsCverRt())
+    CverNoVptrMap =
+        Args.hasFlag(options::OPT_fsanitize_cver_no_vptr_map,
+                     options::OPT_fno_sanitize_cver_no_vptr_map, false);
+
+  // Parse -f[no-]sanitize-cver-typed-new options.
+  if (needsCverRt())
+    CverTypedNew =
+        Args.hasFlag(options::OPT_fsanitize_cver_typed_new,
+                     options::OPT_fno_sanitize_cver_typed_new, false);
+
   if (NeedsAsan) {
     AsanSharedRuntime =
         Args.hasArg(options::OPT_shared_libasan) ||
@@ -191,6 +219,15 @@ void SanitizerArgs::addArgs(const llvm::opt::ArgList &Args,
     CmdArgs.push_back(Args.MakeArgString("-fsanitize-memory-track-origins=" +
                                          llvm::utostr(MsanTrackOrigins)));
 
+  if (CverStackNoExit)
+    CmdArgs.push_back(Args.MakeArgString("-fsanitize-cver-stack-no-exit"));
+  if (CverStackInline)
+    CmdArgs.push_back(Args.MakeArgString("-fsanitize-cver-stack-inline"));
+  if (CverNoVptrMap)
+    CmdArgs.push_back(Args.MakeArgString("-fsanitize-cver-no-vptr-map"));
+  if (CverTypedNew)
+    CmdArgs.push_back(Args.MakeArgString("-fsanitize-cver-typed-new"));
+
   // Workaround for PR16386.
   if (needsMsanRt())
     CmdArgs.push_back(Args.MakeArgString("-fno-assume-sane-operator-new"));
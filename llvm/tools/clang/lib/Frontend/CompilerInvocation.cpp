@@ -484,6 +484,14 @@ static bool ParseCodeGenArgs(CodeGenOptions &Opts, ArgList &Args, InputKind IK,
   Opts.SanitizerBlacklistFile = Args.getLastArgValue(OPT_fsanitize_blacklist);
   Opts.SanitizeMemoryTrackOrigins =
       getLastArgIntValue(Args, OPT_fsanitize_memory_track_origins_EQ, 0, Diags);
+  Opts.SanitizeCverStackNoExit =
+      Args.hasArg(OPT_fsanitize_cver_stack_no_exit);
+  Opts.SanitizeCverStackInline =
+      Args.hasArg(OPT_fsanitize_cver_stack_inline);
+  Opts.SanitizeCverNoVptrMap =
+      Args.hasArg(OPT_fsanitize_cver_no_vptr_map);
+  Opts.SanitizeCverTypedNew =
+      Args.hasArg(OPT_fsanitize_cver_typed_new);
   Opts.SanitizeUndefinedTrapOnError =
       Args.hasArg(OPT_fsanitize_undefined_trap_on_error);
   Opts.SSPBufferSize =
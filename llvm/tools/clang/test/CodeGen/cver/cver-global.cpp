@@ -29,14 +29,15 @@ public:
   virtual ~V2(){}
 };
 
-// CHECK: define internal void @__cver_handle_global_wrapper() unnamed_addr #4 {
-// CHECK-NEXT:  call void @__cver_handle_global_var(i8* bitcast (%class.V1* @ap to i8*), i8* bitcast ({ i64, [0 x i64], i64, [4 x i64], [5 x i8] }* @0 to i8*), i64 24)
-// CHECK-NEXT: ret void
-V1 ap;
+// CHECK: $__cver_thtable__ZTI2V1 = comdat any
+// CHECK: @__cver_thtable__ZTI2V1 = linkonce_odr constant {{.*}}, comdat $__cver_thtable__ZTI2V1
 
-// CHECK: define internal void @__cver_handle_global_wrapper1() unnamed_addr #4 {
-// CHECK-NEXT: call void @__cver_handle_global_var(i8* bitcast (%class.D1* @dp to i8*), i8* bitcast ({ i64, [0 x i64], i64, [4 x i64], [5 x i8] }* @1 to i8*), i64 16)
-// CHECK-NEXT: ret void
+// All the global objects of the module are registered by one constructor.
+// CHECK: @__cver_globals = internal constant [2 x { i8*, i64, i8* }] [{ i8*, i64, i8* } { i8* bitcast (%class.V1* @ap to i8*), i64 24, i8* bitcast ({ i64, [0 x { i32, i32, i64 }], i64, [2 x i64], [2 x i32], i64, [4 x i64], i64, [0 x i32], i64, [0 x i64], i64, i64, i8* }* @__cver_thtable__ZTI2V1 to i8*) }, { i8*, i64, i8* } { i8* bitcast (%class.D1* @dp to i8*), i64 16, i8* bitcast ({ i64, [0 x { i32, i32, i64 }], i64, [2 x i64], [2 x i32], i64, [4 x i64], i64, [0 x i32], i64, [0 x i64], i64, i64, i8* }* @__cver_thtable__ZTI2D1 to i8*) }]
+// CHECK: @llvm.global_ctors = {{.*}}@__cver_register_globals_wrapper
+// CHECK: @llvm.global_dtors = {{.*}}@__cver_unregister_globals_wrapper
+// CHECK-NOT: @__cver_handle_global_var
+V1 ap;
 D1 dp;
 
 int main(int argc, char **argv) {
@@ -51,3 +52,13 @@ int main(int argc, char **argv) {
   }
   return 0;
 }
+
+// CHECK: define internal void @__cver_register_globals_wrapper() unnamed_addr
+// CHECK-NEXT: call void @__cver_register_globals(i8* bitcast ([2 x { i8*, i64, i8* }]* @__cver_globals to i8*), i64 2)
+// CHECK-NEXT: ret void
+
+// CHECK: define internal void @__cver_unregister_globals_wrapper() unnamed_addr
+// CHECK-NEXT: call void @__cver_unregister_globals(i8* bitcast ([2 x { i8*, i64, i8* }]* @__cver_globals to i8*), i64 2)
+// CHECK-NEXT: ret void
+
+// CHECK: !cver.thtables = !{!{{[0-9]+}}, !{{[0-9]+}}
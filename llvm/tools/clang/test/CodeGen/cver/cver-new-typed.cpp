@@ -0,0 +1,50 @@
+// Check if cver allocates objects and records their types in one runtime call
+// with -fsanitize-cver-typed-new, unless the allocation function is replaced.
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -fsanitize=cver -fsanitize-cver-typed-new -emit-llvm %s -o - | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -fsanitize=cver -emit-llvm %s -o - | FileCheck %s --check-prefix=DEFAULT
+
+typedef __typeof__(sizeof(0)) size_t;
+
+class S {
+  int _dummy;
+};
+
+class T : public S {
+};
+
+class R : public S {
+public:
+  void *operator new(size_t size);
+};
+
+// Another TU may replace the global operator new, so the fused call is only
+// used on request.
+// CHECK-LABEL: define {{.*}}@_Z6make_tv
+// DEFAULT-LABEL: define {{.*}}@_Z6make_tv
+S *make_t() {
+  // DEFAULT-NOT: @__cver_new_typed(
+  // DEFAULT: call {{.*}}@_Znwm(i64 4)
+  // DEFAULT: call i64 @__cver_handle_new(
+  // CHECK: call i8* @__cver_new_typed(i64 4, i8* bitcast ({{.*}}* @__cver_thtable__ZTI1T to i8*), i64 0)
+  // CHECK-NOT: @_Znwm(
+  // CHECK-NOT: @__cver_handle_new(
+  // CHECK: ret
+  return new T;
+}
+
+// CHECK-LABEL: define {{.*}}@_Z12make_t_arraym
+S *make_t_array(unsigned long n) {
+  // CHECK: call i8* @__cver_new_array_typed(i64 %{{.*}}, i8* bitcast ({{.*}}* @__cver_thtable__ZTI1T to i8*), i64 %{{.*}})
+  // CHECK-NOT: @_Znam(
+  // CHECK-NOT: @__cver_handle_new(
+  // CHECK: ret
+  return new T[n];
+}
+
+// A class-specific operator new keeps the separate __cver_handle_new.
+// CHECK-LABEL: define {{.*}}@_Z6make_rv
+S *make_r() {
+  // CHECK: call i8* @_ZN1RnwEm(i64 4)
+  // CHECK: call i64 @__cver_handle_new(
+  return new R;
+}
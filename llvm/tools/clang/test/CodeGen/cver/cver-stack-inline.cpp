@@ -0,0 +1,67 @@
+// Check if cver registers stack objects inline with -fsanitize-cver-stack-inline,
+// after pruning the ones which do not escape.
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -fsanitize=cver -fsanitize=cver-stack -fsanitize-cver-stack-inline -emit-llvm %s -o - | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -fsanitize=cver -fsanitize=cver-stack -fsanitize-cver-stack-inline -fsanitize-cver-stack-no-exit -emit-llvm %s -o - | FileCheck %s --check-prefix=NOEXIT
+
+class S {
+  int _dummy;
+};
+
+void use(S *p);
+
+// CHECK: @__cver_shadow_stack_top = external thread_local(initialexec) global i64*
+// CHECK: @__cver_shadow_stack_end = external thread_local(initialexec) global i64*
+
+// CHECK-LABEL: define {{.*}}@_Z4scopev
+// NOEXIT-LABEL: define {{.*}}@_Z4scopev
+void scope() {
+  // CHECK: [[SAVED_TOP:%.*]] = alloca i64*
+  // CHECK: store i64* null, i64** [[SAVED_TOP]]
+  // CHECK: [[TOP:%.*]] = load i64** @__cver_shadow_stack_top
+  // CHECK: [[END:%.*]] = load i64** @__cver_shadow_stack_end
+  // CHECK: store i64* [[TOP]], i64** [[SAVED_TOP]]
+  // CHECK: [[CMP:%.*]] = icmp ult i64* [[TOP]], [[END]]
+  // CHECK: br i1 [[CMP]], label %cver.stack.inline, label %cver.stack.slow
+  // CHECK: cver.stack.inline:
+  // CHECK: store i64 %{{.*}}, i64* [[TOP]]
+  // CHECK: [[SIZE:%.*]] = getelementptr i64* [[TOP]], i32 1
+  // CHECK: store i64 4, i64* [[SIZE]]
+  // CHECK: [[TT:%.*]] = getelementptr i64* [[TOP]], i32 2
+  // CHECK: store i64 ptrtoint ({{.*}}* @__cver_thtable__ZTI1S to i64), i64* [[TT]]
+  // CHECK: [[NEXT:%.*]] = getelementptr i64* [[TOP]], i32 3
+  // CHECK: store i64* [[NEXT]], i64** @__cver_shadow_stack_top
+  // CHECK: cver.stack.slow:
+  // CHECK: call i64 @__cver_handle_stack_enter
+  // CHECK: cver.stack.cont:
+  S s;
+  use(&s);
+  // The entry is popped inline if it is still the last one.
+  // CHECK: [[SAVED:%.*]] = load i64** [[SAVED_TOP]]
+  // CHECK: [[CUR:%.*]] = load i64** @__cver_shadow_stack_top
+  // CHECK: [[PAST:%.*]] = getelementptr i64* [[SAVED]], i32 3
+  // CHECK: [[IS_LAST:%.*]] = icmp eq i64* [[CUR]], [[PAST]]
+  // CHECK: br i1 [[IS_LAST]], label %cver.stack.exit.check, label %cver.stack.exit.slow
+  // CHECK: cver.stack.exit.check:
+  // CHECK: [[ADDR:%.*]] = load i64* [[SAVED]]
+  // CHECK: [[IS_OWN:%.*]] = icmp eq i64 [[ADDR]], %{{.*}}
+  // CHECK: br i1 [[IS_OWN]], label %cver.stack.exit.inline, label %cver.stack.exit.slow
+  // CHECK: cver.stack.exit.inline:
+  // CHECK: store i64* [[SAVED]], i64** @__cver_shadow_stack_top
+  // CHECK: cver.stack.exit.slow:
+  // CHECK: call i64 @__cver_handle_stack_exit
+  // CHECK: cver.stack.exit.cont:
+  // CHECK: ret void
+  // NOEXIT-NOT: cver.stack.exit
+  // NOEXIT-NOT: @__cver_handle_stack_exit
+  // NOEXIT: ret void
+}
+
+// The hooks are pruned before they are lowered, so nothing is left of them.
+// CHECK-LABEL: define {{.*}}@_Z5localv
+void local() {
+  // CHECK-NOT: @__cver_shadow_stack_top
+  // CHECK-NOT: @__cver_handle_stack_enter
+  // CHECK-NOT: @__cver_handle_stack_exit
+  S s;
+  // CHECK: ret void
+}
@@ -0,0 +1,21 @@
+// Check if cver skips __cver_handle_stack_exit with -fsanitize-cver-stack-no-exit.
+// RUN: %clang_cc1 -fsanitize=cver -fsanitize=cver-stack -emit-llvm %s -o - | FileCheck %s
+// RUN: %clang_cc1 -fsanitize=cver -fsanitize=cver-stack -fsanitize-cver-stack-no-exit -emit-llvm %s -o - | FileCheck %s --check-prefix=NOEXIT
+
+class S {
+  int _dummy;
+};
+
+void use(S *p);
+
+// CHECK-LABEL: define {{.*}}@_Z4scopev
+// NOEXIT-LABEL: define {{.*}}@_Z4scopev
+void scope() {
+  // CHECK: call i64 @__cver_handle_stack_enter
+  // NOEXIT: call i64 @__cver_handle_stack_enter
+  S s;
+  use(&s);
+  // CHECK: call i64 @__cver_handle_stack_exit
+  // NOEXIT-NOT: @__cver_handle_stack_exit
+  // NOEXIT: ret void
+}
@@ -1,5 +1,6 @@
 // RUN: %clang_cc1 -fsanitize=cver -fsanitize=cver-stack -emit-llvm %s -o - |c++filt|FileCheck %s --strict-whitespace -check-prefix=PRUNE
 // RUN: %clang_cc1 -fsanitize=cver -fsanitize=cver-stack -emit-llvm %s -mllvm -disable-cver-stack-prune -o - |c++filt|FileCheck %s --strict-whitespace -check-prefix=DISABLE-PRUNE
+// RUN: %clang_cc1 -fsanitize=cver -fsanitize=cver-stack -emit-llvm %s -mllvm -cver-stack-prune-whole-program -o - |c++filt|FileCheck %s --strict-whitespace -check-prefix=WHOLE
 
 class S {
   int _dummy;
@@ -49,13 +50,125 @@ int bad(void) {
 // PRUNE: define i32 @good_bad()() #0
 // DISABLE-PRUNE: define i32 @good_bad()() #0
 int good_bad(void) {
+  // s never escapes, even though bad() casts.
+  // PRUNE-NOT: call i64 @__cver_handle_stack_enter
+  // PRUNE-NOT: call i64 @__cver_handle_stack_exit
+  S s;
+  bad();
+  return 1;
+  // DISABLE-PRUNE: call i64 @__cver_handle_stack_enter
+  // DISABLE-PRUNE: call i64 @__cver_handle_stack_exit
+}
+
+// PRUNE: define i32 @cast_other(S*, int)(%class.S* %p, i32 %n) #0
+// DISABLE-PRUNE: define i32 @cast_other(S*, int)(%class.S* %p, i32 %n) #0
+int cast_other(S *p, int n) {
+  // Only the escaping one is tracked.
   // PRUNE: call i64 @__cver_handle_stack_enter
+  // PRUNE-NOT: call i64 @__cver_handle_stack_enter
   // PRUNE: call i64 @__cver_handle_stack_exit
+  // PRUNE-NOT: call i64 @__cver_handle_stack_exit
+  // PRUNE: ret i32
+  S local;
+  S escaping;
+  T *pt = static_cast<T*>(p);
+  pt = static_cast<T*>(&escaping);
+  // DISABLE-PRUNE: call i64 @__cver_handle_stack_enter
+  // DISABLE-PRUNE: call i64 @__cver_handle_stack_enter
+  // DISABLE-PRUNE: call i64 @__cver_handle_stack_exit
+  // DISABLE-PRUNE: call i64 @__cver_handle_stack_exit
+  return 1;
+}
+
+void take(S *p) {
+}
+
+void cast_pair(S *p, int n) {
+  T *pt = static_cast<T*>(p);
+}
+
+void (*take_fp)(S *) = take;
+void (*cast_pair_fp)(S *, int) = cast_pair;
+
+// PRUNE: define i32 @indirect_good()() #0
+// DISABLE-PRUNE: define i32 @indirect_good()() #0
+// WHOLE: define i32 @indirect_good()() #0
+int indirect_good(void) {
+  // s escapes into an indirect call, which may reach another TU. With the
+  // whole program, no function of the same arity casts.
+  // PRUNE: call i64 @__cver_handle_stack_enter
+  // PRUNE: call i64 @__cver_handle_stack_exit
+  // WHOLE-NOT: call i64 @__cver_handle_stack_enter
+  // WHOLE-NOT: call i64 @__cver_handle_stack_exit
+  // WHOLE: ret i32
   S s;
-  bad();
+  take_fp(&s);
+  // DISABLE-PRUNE: call i64 @__cver_handle_stack_enter
+  // DISABLE-PRUNE: call i64 @__cver_handle_stack_exit
   return 1;
+}
+
+// PRUNE: define i32 @indirect_bad()() #0
+// DISABLE-PRUNE: define i32 @indirect_bad()() #0
+// WHOLE: define i32 @indirect_bad()() #0
+int indirect_bad(void) {
+  // cast_pair() may be called through the pointer.
+  // PRUNE: call i64 @__cver_handle_stack_enter
+  // PRUNE: call i64 @__cver_handle_stack_exit
+  // WHOLE: call i64 @__cver_handle_stack_enter
+  // WHOLE: call i64 @__cver_handle_stack_exit
+  S s;
+  cast_pair_fp(&s, 0);
   // DISABLE-PRUNE: call i64 @__cver_handle_stack_enter
   // DISABLE-PRUNE: call i64 @__cver_handle_stack_exit
+  return 1;
+}
+
+// Defined in another TU, and may cast.
+void extern_take(S *p, int a, int b);
+void (*extern_take_fp)(S *, int, int) = extern_take;
+
+// PRUNE: define i32 @direct_decl()() #0
+// WHOLE: define i32 @direct_decl()() #0
+int direct_decl(void) {
+  // PRUNE: call i64 @__cver_handle_stack_enter
+  // PRUNE: call i64 @__cver_handle_stack_exit
+  // WHOLE: call i64 @__cver_handle_stack_enter
+  // WHOLE: call i64 @__cver_handle_stack_exit
+  S s;
+  extern_take(&s, 0, 0);
+  return 1;
+}
+
+// PRUNE: define i32 @indirect_decl()() #0
+// WHOLE: define i32 @indirect_decl()() #0
+int indirect_decl(void) {
+  // The only address-taken function of the same arity is only declared.
+  // PRUNE: call i64 @__cver_handle_stack_enter
+  // PRUNE: call i64 @__cver_handle_stack_exit
+  // WHOLE: call i64 @__cver_handle_stack_enter
+  // WHOLE: call i64 @__cver_handle_stack_exit
+  S s;
+  extern_take_fp(&s, 0, 0);
+  return 1;
+}
+
+// Visible outside the module, so it may be called through a pointer taken in
+// another one, though its address is not taken here.
+void extern_cast(S *p, int a, int b, int c) {
+  T *pt = static_cast<T*>(p);
+}
+
+extern void (*opaque_fp)(S *, int, int, int);
+
+// WHOLE: define i32 @indirect_extern_def()() #0
+int indirect_extern_def(void) {
+  // The only function of the same arity is defined here, but external.
+  // WHOLE: call i64 @__cver_handle_stack_enter
+  // WHOLE: call i64 @__cver_handle_stack_exit
+  S s;
+  opaque_fp(&s, 0, 0, 0);
+  return 1;
 }
 
 // PRUNE: define i32 @main() #0
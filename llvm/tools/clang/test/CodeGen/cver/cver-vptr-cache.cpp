@@ -0,0 +1,40 @@
+// Check if cver probes the inline cache before calling the runtime on
+// polymorphic objects.
+// RUN: %clang_cc1 -fsanitize=cver -emit-llvm %s -o - | FileCheck %s --strict-whitespace
+
+class S {
+  int _dummy;
+};
+
+class T : public S {
+};
+
+class PS {
+public:
+  virtual ~PS() {}
+};
+
+class PT : public PS {
+  int _dummy;
+};
+
+// CHECK-LABEL: define {{.*}}@_Z13cast_non_polyP1S
+T *cast_non_poly(S *ps) {
+  // CHECK-NOT: @__cver_vptr_type_cache
+  // CHECK: call i64 @__cver_handle_cast(
+  return static_cast<T*>(ps);
+}
+
+// CHECK-LABEL: define {{.*}}@_Z9cast_polyP2PS
+PT *cast_poly(PS *ps) {
+  // CHECK: icmp eq %class.PS* %{{.*}}, null
+  // CHECK: getelementptr inbounds [1024 x i64]* @__cver_vptr_type_cache, i32 0, i64 %{{.*}}
+  // CHECK: br i1 %{{.*}}, label %cver.cont, label %cver.cache.miss
+  // CHECK: cver.cache.miss:
+  // CHECK: call i64 @__cver_handle_cast_cache_miss(i8* {{.*}}, i64 %{{.*}}, i64 %{{.*}}, i64 %{{.*}})
+  // The result of the check is available after it: good for null pointers
+  // and cache hits, and the result of the runtime on a miss.
+  // CHECK: cver.cont:
+  // CHECK-NEXT: %cver.result = phi i64 [ 1, %{{.*}} ], [ 1, %cver.not.null ], [ %{{.*}}, %cver.cache.miss ]
+  return static_cast<PT*>(ps);
+}
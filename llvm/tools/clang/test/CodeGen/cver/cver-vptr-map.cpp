@@ -0,0 +1,63 @@
+// Check if cver registers vtable address points, and skips __cver_handle_new
+// on polymorphic objects which the runtime can locate by their vptrs.
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -fsanitize=cver -emit-llvm %s -o - | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -fsanitize=cver -emit-llvm %s -o - | FileCheck %s --check-prefix=VTABLE
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -fsanitize=cver -fsanitize-cver-no-vptr-map -emit-llvm %s -o - | FileCheck %s --check-prefix=NOMAP
+
+class S {
+public:
+  virtual ~S();
+};
+S::~S() {}
+
+class T : public S {
+};
+
+class NonPoly {
+  int _dummy;
+};
+
+class U : public S, public NonPoly {
+};
+
+// The key function is defined in another TU, which may not be instrumented.
+class V : public S {
+public:
+  virtual void f();
+};
+
+// CHECK-LABEL: define {{.*}}@_Z6make_tv
+// NOMAP-LABEL: define {{.*}}@_Z6make_tv
+S *make_t() {
+  // CHECK-NOT: @__cver_handle_new(
+  // CHECK: ret
+  // NOMAP: call i64 @__cver_handle_new(
+  return new T;
+}
+
+// A cast from NonPoly* cannot find U by a vptr.
+// CHECK-LABEL: define {{.*}}@_Z6make_uv
+S *make_u() {
+  // CHECK: call i64 @__cver_handle_new(
+  return new U;
+}
+
+// The vtable of V may never be registered.
+// CHECK-LABEL: define {{.*}}@_Z6make_vv
+S *make_v() {
+  // CHECK: call i64 @__cver_handle_new(
+  return new V;
+}
+
+// The address points of all the vtables emitted in the module are registered
+// through one array, by a single pair of ctor and dtor.
+// VTABLE-NOT: @__cver_handle_vtable
+// VTABLE: @__cver_vtables = internal constant [{{[0-9]+}} x { i8*, i8*, i64 }] [{{.*}}{ i8*, i8*, i64 } { i8* bitcast (i8** getelementptr inbounds ([4 x i8*]* @_ZTV1S, i64 0, i64 2) to i8*), i8* bitcast ({{.*}}* @__cver_thtable__ZTI1S to i8*), i64 0 }
+// VTABLE-NOT: @_ZTV1V
+// VTABLE: @llvm.global_ctors = appending global {{.*}}@__cver_register_vtables_wrapper
+// VTABLE: @llvm.global_dtors = appending global {{.*}}@__cver_unregister_vtables_wrapper
+// VTABLE: define internal void @__cver_register_vtables_wrapper()
+// VTABLE-NEXT: call void @__cver_register_vtables(i8* bitcast ({{.*}}* @__cver_vtables to i8*), i64 {{[0-9]+}})
+// VTABLE: define internal void @__cver_unregister_vtables_wrapper()
+// VTABLE-NEXT: call void @__cver_unregister_vtables(i8* bitcast ({{.*}}* @__cver_vtables to i8*), i64 {{[0-9]+}})
+// VTABLE-NOT: @__cver_register_vtables_wrapper{{[0-9]+}}